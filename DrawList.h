@@ -0,0 +1,491 @@
+//                        MIT License
+//
+//                  Copyright (c) 2024 Toby
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////
+/*                  DrawList.h
+
+          2D geometry for the GUI and sprites.
+
+          DrawVert  - pos + uv + col, 20 bytes.
+          DrawCmd   - a range of indices drawn with one
+                      texture and clip rect (one GPU
+                      draw call).
+          DrawList  - vertex, index and command buffers,
+                      one per GUI window / 2D layer.
+          DrawData  - the lists of a frame, what the
+                      renderer consumes.
+
+          Buffers keep their capacity across frames:
+          reset() only rewinds, so once a list has
+          reached its frame's size nothing allocates.
+          reserve() preallocates from last frame's
+          counts (window MemoryDrawListVtxCapacity and
+          MemoryDrawListIdxCapacity).
+
+          prim_reserve() hands out write pointers into
+          the buffers, the prim_* helpers fill them
+          without bounds checks or per vertex push_back.
+
+          list.prim_reserve(6, 4);
+          list.prim_rect(a, b, DRAW_COL32(255, 0, 0, 255));
+
+          Culling happens at record time: the add_*
+          helpers drop rects that lie entirely outside
+          the current clip rect, so a scrolled list only
+          pays vertices for its visible rows.
+          add_rects_filled() tests an array in chunks
+          without branches and writes the survivors
+          with one prim_reserve() per chunk.
+
+          Commands are only split when something
+          actually changed: setting the state the
+          current command already has is free, and
+          going back to the previous command's state
+          before drawing anything (A, B culled, A)
+          continues that command instead of opening
+          a new one.
+
+          DrawListSplitter records from several threads:
+          one DrawChannel per window or layer, merged
+          in channel order, so the result doesn't
+          depend on which thread recorded what.
+
+          splitter.split(window_count);
+          jobs.parallel_for(0, window_count, 0, [&](int start, int end) {
+              for (int i = start; i < end; i++) build_window(i, splitter.get_channel(i));
+          });
+          splitter.merge(merged, &jobs);
+*/
+////////////////////////////////////////////////
+
+#ifndef DRAW_LIST_H
+#define DRAW_LIST_H
+
+#include "Variants.h"
+#include "Jobs.h"
+
+#define DRAW_COL32(R, G, B, A)  (((uint32)(A) << 24) | ((uint32)(B) << 16) | ((uint32)(G) << 8) | ((uint32)(R)))
+#define DRAW_COL32_WHITE        DRAW_COL32(255, 255, 255, 255)
+
+#define DRAW_SPLITTER_MERGE_GRAIN   32      // Channels per merge job
+#define DRAW_CULL_CHUNK             256     // Rects tested per batch in add_rects_filled()
+
+typedef uint32 DrawIdx;         // 32 bit, a list can hold more than 64k vertices without splitting commands
+typedef uint32 DrawTextureID;   // GL name, 0 = no texture
+
+struct DrawVert
+{
+    Vector2     pos;
+    Vector2     uv;
+    uint32      col;            // RGBA8, DRAW_COL32()
+};
+
+static_assert(sizeof(DrawVert) == 20, "DrawVert is uploaded as is, keep it 20 bytes");
+
+struct DrawCmd
+{
+    Vector4         ClipRect;       // x1, y1, x2, y2 in display coordinates
+    DrawTextureID   Texture;
+    uint32          State;          // Shader and blend mode, opaque to the list (see SpriteBatch.h)
+    uint32          VtxOffset;      // Added to the indices, lets a renderer draw several lists from one buffer
+    uint32          IdxOffset;      // First index in the list's IdxBuffer
+    uint32          ElemCount;      // Indices, a multiple of 3
+};
+
+class DrawList
+{
+public:
+    TArray<DrawCmd>     CmdBuffer;
+    TArray<DrawIdx>     IdxBuffer;
+    TArray<DrawVert>    VtxBuffer;
+
+    // Filled by prim_reserve(), advanced by the prim_* helpers
+    DrawVert*           VtxWritePtr;
+    DrawIdx*            IdxWritePtr;
+    uint32              VtxCurrentIdx;  // Index of the next vertex, what prim_write_idx() refers to
+
+    DrawList() : VtxWritePtr(nullptr), IdxWritePtr(nullptr), VtxCurrentIdx(0), ClipRect(-8192.0f, -8192.0f, 8192.0f, 8192.0f), Texture(0), State(0) {}
+
+    // Start of a frame: empties the list, keeps the storage.
+    void reset() {
+        CmdBuffer.shrink(0);
+        IdxBuffer.shrink(0);
+        VtxBuffer.shrink(0);
+        VtxWritePtr = nullptr;
+        IdxWritePtr = nullptr;
+        VtxCurrentIdx = 0;
+        ClipRect = Vector4(-8192.0f, -8192.0f, 8192.0f, 8192.0f);
+        Texture = 0;
+        State = 0;
+        add_draw_cmd();
+    }
+
+    // Capacity hint, typically last frame's counts. Never shrinks.
+    void reserve(int vtx_count, int idx_count) {
+        VtxBuffer.reserve(vtx_count);
+        IdxBuffer.reserve(idx_count);
+    }
+
+    // Release the storage of a list that went idle (hidden window).
+    void compact() {
+        CmdBuffer.clear();
+        IdxBuffer.clear();
+        VtxBuffer.clear();
+        VtxWritePtr = nullptr;
+        IdxWritePtr = nullptr;
+        VtxCurrentIdx = 0;
+    }
+
+    void set_clip_rect(const Vector4& clip_rect) {
+        ClipRect = clip_rect;
+        on_state_changed();
+    }
+
+    void set_texture(DrawTextureID texture) {
+        Texture = texture;
+        on_state_changed();
+    }
+
+    void set_state(uint32 state) {
+        State = state;
+        on_state_changed();
+    }
+
+    const Vector4&  get_clip_rect() const   { return ClipRect; }
+    DrawTextureID   get_texture() const     { return Texture; }
+    uint32          get_state() const       { return State; }
+
+    // Makes room for the primitive and points VtxWritePtr/IdxWritePtr at it. Write exactly that much.
+    void prim_reserve(int idx_count, int vtx_count) {
+        assert(idx_count >= 0 && vtx_count >= 0);
+        if (CmdBuffer.empty())
+            add_draw_cmd();
+        CmdBuffer.back().ElemCount += idx_count;
+
+        const int vtx_size = VtxBuffer.size();
+        VtxBuffer.resize_uninitialized(vtx_size + vtx_count);
+        VtxWritePtr = VtxBuffer.begin() + vtx_size;
+
+        const int idx_size = IdxBuffer.size();
+        IdxBuffer.resize_uninitialized(idx_size + idx_count);
+        IdxWritePtr = IdxBuffer.begin() + idx_size;
+    }
+
+    // Gives back what a prim_reserve() didn't use (clipped, degenerate).
+    void prim_unreserve(int idx_count, int vtx_count) {
+        assert(idx_count >= 0 && vtx_count >= 0);
+        CmdBuffer.back().ElemCount -= idx_count;
+        VtxBuffer.shrink(VtxBuffer.size() - vtx_count);
+        IdxBuffer.shrink(IdxBuffer.size() - idx_count);
+    }
+
+    void prim_write_vtx(const Vector2& pos, const Vector2& uv, uint32 col) {
+        VtxWritePtr->pos = pos;
+        VtxWritePtr->uv = uv;
+        VtxWritePtr->col = col;
+        VtxWritePtr++;
+        VtxCurrentIdx++;
+    }
+
+    void prim_write_idx(DrawIdx idx) { *IdxWritePtr++ = idx; }
+
+    // Axis aligned quad, 6 indices / 4 vertices reserved.
+    void prim_rect_uv(const Vector2& a, const Vector2& c, const Vector2& uv_a, const Vector2& uv_c, uint32 col) {
+        const DrawIdx idx = (DrawIdx)VtxCurrentIdx;
+        IdxWritePtr[0] = idx; IdxWritePtr[1] = idx + 1; IdxWritePtr[2] = idx + 2;
+        IdxWritePtr[3] = idx; IdxWritePtr[4] = idx + 2; IdxWritePtr[5] = idx + 3;
+        VtxWritePtr[0].pos = a;                 VtxWritePtr[0].uv = uv_a;                   VtxWritePtr[0].col = col;
+        VtxWritePtr[1].pos = Vector2(c.x, a.y); VtxWritePtr[1].uv = Vector2(uv_c.x, uv_a.y); VtxWritePtr[1].col = col;
+        VtxWritePtr[2].pos = c;                 VtxWritePtr[2].uv = uv_c;                   VtxWritePtr[2].col = col;
+        VtxWritePtr[3].pos = Vector2(a.x, c.y); VtxWritePtr[3].uv = Vector2(uv_a.x, uv_c.y); VtxWritePtr[3].col = col;
+        VtxWritePtr += 4;
+        VtxCurrentIdx += 4;
+        IdxWritePtr += 6;
+    }
+
+    // Untextured, samples the white texel at uv (0, 0).
+    void prim_rect(const Vector2& a, const Vector2& c, uint32 col) { prim_rect_uv(a, c, Vector2(0.0f, 0.0f), Vector2(0.0f, 0.0f), col); }
+
+    // False when the rect (a top left, c bottom right) lies entirely outside the clip rect. Touching an edge is outside.
+    bool is_rect_visible(const Vector2& a, const Vector2& c) const {
+        return a.x < ClipRect.z && a.y < ClipRect.w && c.x > ClipRect.x && c.y > ClipRect.y;
+    }
+
+    void add_rect_filled(const Vector2& a, const Vector2& c, uint32 col) {
+        if ((col >> 24) == 0 || !is_rect_visible(a, c))
+            return;
+        prim_reserve(6, 4);
+        prim_rect(a, c, col);
+    }
+
+    // Rects as x1, y1, x2, y2 like ClipRect. Returns how many were recorded.
+    // Tested in chunks: survivors are compacted without branches, then written with one prim_reserve() per chunk.
+    // Pays off on scattered rects (particles, tiles); sorted rows cull just as well one add_rect_filled() at a time.
+    int add_rects_filled(const Vector4* rects, const uint32* cols, int count) {
+        const Vector4 clip = ClipRect;
+        int kept[DRAW_CULL_CHUNK];
+        int total = 0;
+        for (int start = 0; start < count; start += DRAW_CULL_CHUNK) {
+            const int end = Min(start + DRAW_CULL_CHUNK, count);
+            int visible = 0;
+            for (int i = start; i < end; i++) {
+                kept[visible] = i;
+                visible += rect_visible_mask(rects[i], cols[i], clip);
+            }
+            if (visible == 0)
+                continue;
+            prim_reserve(visible * 6, visible * 4);
+            for (int n = 0; n < visible; n++) {
+                const Vector4& r = rects[kept[n]];
+                prim_rect(Vector2(r.x, r.y), Vector2(r.z, r.w), cols[kept[n]]);
+            }
+            total += visible;
+        }
+        return total;
+    }
+
+    void add_image(DrawTextureID texture, const Vector2& a, const Vector2& c, const Vector2& uv_a = Vector2(0.0f, 0.0f), const Vector2& uv_c = Vector2(1.0f, 1.0f), uint32 col = DRAW_COL32_WHITE) {
+        if (!is_rect_visible(a, c))
+            return;
+        if (texture != Texture)
+            set_texture(texture);
+        prim_reserve(6, 4);
+        prim_rect_uv(a, c, uv_a, uv_c, col);
+    }
+
+private:
+    void add_draw_cmd() {
+        DrawCmd cmd;
+        cmd.ClipRect = ClipRect;
+        cmd.Texture = Texture;
+        cmd.State = State;
+        cmd.VtxOffset = 0;
+        cmd.IdxOffset = (uint32)IdxBuffer.size();
+        cmd.ElemCount = 0;
+        CmdBuffer.push_back(cmd);
+    }
+
+    bool is_current_state(const DrawCmd& cmd) const {
+        return cmd.ClipRect.x == ClipRect.x && cmd.ClipRect.y == ClipRect.y && cmd.ClipRect.z == ClipRect.z && cmd.ClipRect.w == ClipRect.w
+            && cmd.Texture == Texture && cmd.State == State;
+    }
+
+    // 1 or 0 without branches, a rejected rect costs no mispredict in add_rects_filled().
+    static int rect_visible_mask(const Vector4& r, uint32 col, const Vector4& clip) {
+        return (int)(r.x < clip.z) & (int)(r.y < clip.w) & (int)(r.z > clip.x) & (int)(r.w > clip.y) & (int)((col >> 24) != 0);
+    }
+
+    // A command that hasn't drawn anything yet is retargeted instead of starting a new one,
+    // or dropped when the previous command already has the state (its indices end right here).
+    void on_state_changed() {
+        if (CmdBuffer.empty()) {
+            add_draw_cmd();
+            return;
+        }
+        DrawCmd& cmd = CmdBuffer.back();
+        if (is_current_state(cmd))
+            return;
+        if (cmd.ElemCount != 0) {
+            add_draw_cmd();
+            return;
+        }
+        if (CmdBuffer.size() > 1 && is_current_state(CmdBuffer[CmdBuffer.size() - 2])) {
+            CmdBuffer.pop_back();
+            return;
+        }
+        cmd.ClipRect = ClipRect;
+        cmd.Texture = Texture;
+        cmd.State = State;
+    }
+
+    Vector4             ClipRect;
+    DrawTextureID       Texture;
+    uint32              State;
+};
+
+// Everything to render a frame. Points at the lists, doesn't own them.
+struct DrawData
+{
+    bool                Valid;
+    int                 TotalIdxCount;
+    int                 TotalVtxCount;
+    TArray<DrawList*>   CmdLists;
+    Vector2             DisplayPos;     // Top left of the projection
+    Vector2             DisplaySize;
+
+    DrawData() { clear(); }
+
+    void clear() {
+        Valid = false;
+        TotalIdxCount = 0;
+        TotalVtxCount = 0;
+        CmdLists.shrink(0);
+        DisplayPos = Vector2(0.0f, 0.0f);
+        DisplaySize = Vector2(0.0f, 0.0f);
+    }
+
+    // Empty lists are skipped.
+    void add_draw_list(DrawList* list) {
+        if (list->IdxBuffer.empty())
+            return;
+        CmdLists.push_back(list);
+        TotalIdxCount += list->IdxBuffer.size();
+        TotalVtxCount += list->VtxBuffer.size();
+        Valid = true;
+    }
+};
+
+// Recorded by one thread at a time. The bases are where merge() put it.
+struct DrawChannel
+{
+    DrawList    List;
+    uint32      VtxBase;
+    uint32      IdxBase;
+    uint32      CmdBase;
+};
+
+class DrawListSplitter
+{
+public:
+    DrawListSplitter() : ChannelCount(0) {}
+
+    // Resets 'count' channels for recording. Channels are kept between frames with their capacity.
+    void split(int count) {
+        if (Channels.size() < count)
+            Channels.resize(count);
+        ChannelCount = count;
+        for (int i = 0; i < count; i++)
+            Channels[i].List.reset();
+    }
+
+    int         get_channel_count() const   { return ChannelCount; }
+    DrawList&   get_channel(int index)      { assert(index >= 0 && index < ChannelCount); return Channels[index].List; }
+
+    // Flattens the channels into 'out' in channel order, replacing its contents. Indices are rebased,
+    // empty commands dropped. Offsets come from a two pass prefix sum over blocks of channels:
+    // block totals in parallel, a scan of the (few) block totals, then every block copies in parallel.
+    void merge(DrawList& out, JobSystem* jobs = nullptr) {
+        const int block_count = (ChannelCount + DRAW_SPLITTER_MERGE_GRAIN - 1) / DRAW_SPLITTER_MERGE_GRAIN;
+        Blocks.resize(block_count);
+        for_each_block(jobs, block_count, [this](int block) { sum_block(block); });
+
+        uint32 vtx = 0, idx = 0, cmd = 0;
+        for (int i = 0; i < block_count; i++) {
+            MergeBlock& b = Blocks[i];
+            const uint32 vtx_count = b.VtxBase, idx_count = b.IdxBase, cmd_count = b.CmdBase;
+            b.VtxBase = vtx;
+            b.IdxBase = idx;
+            b.CmdBase = cmd;
+            vtx += vtx_count;
+            idx += idx_count;
+            cmd += cmd_count;
+        }
+
+        out.CmdBuffer.shrink(0);
+        out.VtxBuffer.shrink(0);
+        out.IdxBuffer.shrink(0);
+        out.CmdBuffer.resize_uninitialized((int)cmd);
+        out.VtxBuffer.resize_uninitialized((int)vtx);
+        out.IdxBuffer.resize_uninitialized((int)idx);
+        for_each_block(jobs, block_count, [this, &out](int block) { copy_block(block, out); });
+
+        out.VtxCurrentIdx = vtx;
+        out.VtxWritePtr = out.VtxBuffer.end();
+        out.IdxWritePtr = out.IdxBuffer.end();
+    }
+
+    // Frees every channel's storage, for when a lot fewer channels are needed from now on.
+    void clear_free_memory() {
+        Channels.clear();
+        Blocks.clear();
+        ChannelCount = 0;
+    }
+
+private:
+    struct MergeBlock
+    {
+        uint32  VtxBase;    // Block totals until the scan turns them into offsets
+        uint32  IdxBase;
+        uint32  CmdBase;
+    };
+
+    template<typename F>
+    void for_each_block(JobSystem* jobs, int block_count, const F& func) {
+        if (jobs && block_count > 1) {
+            jobs->parallel_for(0, block_count, 1, [&func](int start, int end) {
+                for (int i = start; i < end; i++)
+                    func(i);
+            });
+            return;
+        }
+        for (int i = 0; i < block_count; i++)
+            func(i);
+    }
+
+    void sum_block(int block) {
+        MergeBlock& b = Blocks[block];
+        b.VtxBase = b.IdxBase = b.CmdBase = 0;
+        const int end = Min((block + 1) * DRAW_SPLITTER_MERGE_GRAIN, ChannelCount);
+        for (int i = block * DRAW_SPLITTER_MERGE_GRAIN; i < end; i++) {
+            const DrawList& list = Channels[i].List;
+            b.VtxBase += (uint32)list.VtxBuffer.size();
+            b.IdxBase += (uint32)list.IdxBuffer.size();
+            for (int c = 0; c < list.CmdBuffer.size(); c++)
+                b.CmdBase += list.CmdBuffer[c].ElemCount ? 1 : 0;
+        }
+    }
+
+    void copy_block(int block, DrawList& out) {
+        const MergeBlock& b = Blocks[block];
+        uint32 vtx = b.VtxBase, idx = b.IdxBase, cmd = b.CmdBase;
+        const int end = Min((block + 1) * DRAW_SPLITTER_MERGE_GRAIN, ChannelCount);
+        for (int i = block * DRAW_SPLITTER_MERGE_GRAIN; i < end; i++) {
+            DrawChannel& channel = Channels[i];
+            const DrawList& list = channel.List;
+            channel.VtxBase = vtx;
+            channel.IdxBase = idx;
+            channel.CmdBase = cmd;
+            if (list.VtxBuffer.size())
+                memcpy(out.VtxBuffer.begin() + vtx, list.VtxBuffer.begin(), list.VtxBuffer.size() * sizeof(DrawVert));
+            DrawIdx* dst = out.IdxBuffer.begin() + idx;
+            const DrawIdx* src = list.IdxBuffer.begin();
+            for (int n = 0; n < list.IdxBuffer.size(); n++)
+                dst[n] = src[n] + vtx;
+            for (int c = 0; c < list.CmdBuffer.size(); c++) {
+                if (!list.CmdBuffer[c].ElemCount)
+                    continue;
+                DrawCmd& dst_cmd = out.CmdBuffer[(int)cmd++];
+                dst_cmd = list.CmdBuffer[c];
+                dst_cmd.IdxOffset += idx;
+            }
+            vtx += (uint32)list.VtxBuffer.size();
+            idx += (uint32)list.IdxBuffer.size();
+        }
+    }
+
+    TArray<DrawChannel>     Channels;
+    int                     ChannelCount;
+    TArray<MergeBlock>      Blocks;
+};
+
+#endif // DRAW_LIST_H
@@ -0,0 +1,248 @@
+//                        MIT License
+//
+//                  Copyright (c) 2024 Toby
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////
+/*                  Engine.h
+
+          Owns the engine wide systems and runs one
+          frame per iteration().
+
+          The frame is a FrameGraph of phases:
+
+          Input -> Scripts -> Tweens ------------\
+                          \-> Physics -> Culling -> DrawLists -> Submit
+                          \-> Animation -/
+
+          Subsystems plug into a phase with set_phase().
+          The Input phase drains GetInputEventQueue()
+          into get_input() unless it is replaced. It
+          also records, or replays a recording instead
+          of the live input, for repeatable benchmark
+          runs.
+*/
+////////////////////////////////////////////////
+
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include "FrameGraph.h"
+#include "Input.h"
+#include "FramePacer.h"
+
+#define ENGINE_PHASE_INPUT          0
+#define ENGINE_PHASE_SCRIPTS        1
+#define ENGINE_PHASE_TWEENS         2
+#define ENGINE_PHASE_PHYSICS        3
+#define ENGINE_PHASE_ANIMATION      4
+#define ENGINE_PHASE_CULLING        5
+#define ENGINE_PHASE_DRAW_LISTS     6
+#define ENGINE_PHASE_SUBMIT         7   // Main thread, GL context owner
+#define ENGINE_PHASE_COUNT          8
+
+// Shown by the stats overlay
+struct EngineStats
+{
+    double      FrameMs;
+    double      CriticalPathMs;
+    size_t      FrameAllocatedBytes;    // FrameAllocator
+    size_t      HeapLiveBytes;          // All MEMORY_TAG_* together, see GetMemoryTracker() for the split
+    size_t      HeapFrameAllocBytes;    // Tagged heap allocations during the last frame
+    double      SmoothedFrameMs;        // FramePacer
+    uint64      LateFrames;
+    int         DrawCalls;              // Reported with add_draw_calls() during the frame
+    int         DrawCallsUnbatched;     // What the same draws would have cost in submission order
+};
+
+class Engine
+{
+public:
+    Engine() : FrameCount(0), FixedTimestep(0.0), DeltaTime(0.0), PhysicsSteps(0), Replaying(false), ReplayStartFrame(0), ReplaySavedTimestep(0.0), FrameDrawCalls(0), FrameDrawCallsUnbatched(0) { memset(&Stats, 0, sizeof(Stats)); }
+
+    // 'thread_count' includes the main thread, 0 = one per hardware thread.
+    void init(int thread_count = 0, size_t frame_memory_per_thread = FRAME_ALLOCATOR_DEFAULT_SIZE) {
+        PROFILE_THREAD("Main");
+        GetFrameAllocator().init(frame_memory_per_thread);
+        Jobs.init(thread_count);
+        Inputs.Map = &Actions;
+
+        Phases[ENGINE_PHASE_INPUT]      = Frame.add_system("Input",     &Engine::input_phase, this).write("Input").Index;
+        Phases[ENGINE_PHASE_SCRIPTS]    = Frame.add_system("Scripts",   nullptr, nullptr).read("Input").write("Nodes").Index;
+        Phases[ENGINE_PHASE_TWEENS]     = Frame.add_system("Tweens",    nullptr, nullptr).read("Nodes").write("Tweens").Index;
+        Phases[ENGINE_PHASE_PHYSICS]    = Frame.add_system("Physics",   nullptr, nullptr).read("Nodes").write("Physics").Index;
+        Phases[ENGINE_PHASE_ANIMATION]  = Frame.add_system("Animation", nullptr, nullptr).read("Nodes").write("Skeletons").Index;
+        Phases[ENGINE_PHASE_CULLING]    = Frame.add_system("Culling",   nullptr, nullptr).read("Physics").read("Skeletons").write("Visibility").Index;
+        Phases[ENGINE_PHASE_DRAW_LISTS] = Frame.add_system("DrawLists", nullptr, nullptr).read("Visibility").read("Tweens").write("DrawLists").Index;
+        Phases[ENGINE_PHASE_SUBMIT]     = Frame.add_system("Submit",    nullptr, nullptr).read("DrawLists").main_thread().Index;
+        Frame.compile();
+    }
+
+    // Returns the number of tagged allocations still alive, reported per tag.
+    size_t shutdown() {
+        Jobs.shutdown();
+        Frame.clear();
+        Inputs.Events.clear();
+        Actions.clear();
+        ReplayEvents.clear();
+        Recorder = InputRecorder();
+        stop_input_replay();
+        Replay = InputReplay();
+        GetProfiler().shutdown();
+        GetFrameAllocator().shutdown();
+        return GetMemoryTracker().report_leaks();
+    }
+
+    void set_phase(int phase, FrameSystemFunc func, void* user_data) {
+        assert(phase >= 0 && phase < ENGINE_PHASE_COUNT);
+        Frame.set_system_func(Phases[phase], func, user_data);
+    }
+
+    // Extra systems, ordered after the phases they conflict with.
+    FrameGraph::SystemBuilder add_system(const char* name, FrameSystemFunc func, void* user_data) { return Frame.add_system(name, func, user_data); }
+
+    // 0 = measured wall time between iterations. During a replay it applies once the replay ends.
+    void    set_fixed_timestep(double seconds)  { if (Replaying) ReplaySavedTimestep = seconds; else FixedTimestep = seconds; }
+    double  get_delta_time() const              { return DeltaTime; }
+
+    // iteration() waits out the rest of the frame, 0 = unlimited.
+    void    set_target_fps(double fps)          { Pacer.set_target_fps(fps); }
+    const FramePacerStats& get_pacer_stats() const { return Pacer.get_stats(); }
+
+    // The physics phase runs get_physics_steps() ticks per frame, rendering interpolates by the fraction.
+    void    set_physics_ticks_per_second(int ticks)         { Physics.set_ticks_per_second(ticks); }
+    double  get_physics_step() const                        { return Physics.get_step(); }
+    int     get_physics_steps() const                       { return PhysicsSteps; }
+    double  get_physics_interpolation_fraction() const      { return Physics.get_alpha(); }
+
+    // Replays of this recording step at 'replay_timestep' seconds, whatever the frame times were while recording.
+    // Recordings and replays both start from a reset Input, keys held before don't count until pressed again.
+    void start_input_recording(double replay_timestep = 1.0 / 60.0) { Inputs.reset(); Recorder.begin((uint64)(replay_timestep * 1e9 + 0.5)); }
+    bool stop_input_recording(const char* path)                     { Recorder.end(); return Recorder.save(path); }
+
+    // Live input is ignored until the recording runs out, the delta time is fixed to the recorded step.
+    // The previous fixed timestep comes back when the replay finishes or is stopped.
+    bool start_input_replay(const char* path) {
+        if (!Replay.load(path))
+            return false;
+        if (!Replaying)
+            ReplaySavedTimestep = FixedTimestep;
+        FixedTimestep = (double)Replay.get_timestep_ns() * 1e-9;
+        Inputs.reset();
+        ReplayStartFrame = FrameCount;
+        Replaying = true;
+        return true;
+    }
+    void stop_input_replay() {
+        if (!Replaying)
+            return;
+        Replaying = false;
+        FixedTimestep = ReplaySavedTimestep;
+    }
+    bool is_replaying() const { return Replaying; }
+
+    // Renderers and batchers report their draw calls here (SpriteBatch::get_stats()), any thread.
+    void add_draw_calls(int draw_calls, int unbatched) {
+        FrameDrawCalls.fetch_add(draw_calls, std::memory_order_relaxed);
+        FrameDrawCallsUnbatched.fetch_add(unbatched, std::memory_order_relaxed);
+    }
+
+    // Runs one frame. Call from the main thread.
+    void iteration() {
+        const double measured = Pacer.begin_frame();
+        DeltaTime = FixedTimestep > 0.0 ? FixedTimestep : measured;
+        PhysicsSteps = Physics.advance(DeltaTime);
+
+        GetFrameAllocator().begin_frame();
+        GetMemoryTracker().begin_frame();
+        GetProfiler().begin_frame();
+        {
+            PROFILE_SCOPE("Frame");
+            Frame.execute(Jobs);
+            Jobs.run_main_thread_jobs();
+        }
+        GetProfiler().end_frame();
+        FrameCount++;
+
+        Stats.FrameMs = Frame.get_stats().FrameMs;
+        Stats.CriticalPathMs = Frame.get_stats().CriticalPathMs;
+        Stats.FrameAllocatedBytes = GetFrameAllocator().get_bytes_allocated();
+        Stats.HeapLiveBytes = GetMemoryTracker().get_live_bytes();
+        Stats.HeapFrameAllocBytes = GetMemoryTracker().get_frame_alloc_bytes();
+        Stats.SmoothedFrameMs = Pacer.get_stats().SmoothedMs;
+        Stats.LateFrames = Pacer.get_stats().LateFrames;
+        Stats.DrawCalls = FrameDrawCalls.exchange(0, std::memory_order_relaxed);
+        Stats.DrawCallsUnbatched = FrameDrawCallsUnbatched.exchange(0, std::memory_order_relaxed);
+
+        Pacer.wait();
+    }
+
+    JobSystem&              get_job_system()        { return Jobs; }
+    const FrameGraphStats&  get_frame_stats() const { return Frame.get_stats(); }
+    const EngineStats&      get_stats() const       { return Stats; }
+    const FrameGraph&       get_frame_graph() const { return Frame; }
+    uint64                  get_frame_count() const { return FrameCount; }
+    const Input&            get_input() const       { return Inputs; }
+    InputMap&               get_input_map()         { return Actions; }
+
+private:
+    static void input_phase(void* user_data) {
+        Engine* engine = (Engine*)user_data;
+        if (engine->Replaying) {
+            engine->ReplayEvents.shrink(0);
+            GetInputEventQueue().drain(engine->ReplayEvents);
+            engine->ReplayEvents.shrink(0);
+            engine->Replay.read_frame(engine->FrameCount - engine->ReplayStartFrame, engine->ReplayEvents);
+            engine->Inputs.update(engine->ReplayEvents.begin(), engine->ReplayEvents.size());
+            if (engine->Replay.is_finished())
+                engine->stop_input_replay();
+        } else {
+            engine->Inputs.update(GetInputEventQueue());
+        }
+        engine->Recorder.record_frame(engine->FrameCount, engine->Inputs.Events.begin(), engine->Inputs.Events.size());
+    }
+
+    JobSystem   Jobs;
+    FrameGraph  Frame;
+    int         Phases[ENGINE_PHASE_COUNT];
+    uint64      FrameCount;
+    EngineStats Stats;
+    Input       Inputs;
+    InputMap    Actions;
+
+    double              FixedTimestep;
+    double              DeltaTime;
+    FramePacer          Pacer;
+    FixedStepper        Physics;
+    int                 PhysicsSteps;
+
+    InputRecorder       Recorder;
+    InputReplay         Replay;
+    TArray<InputEvent>  ReplayEvents;
+    bool                Replaying;
+    uint64              ReplayStartFrame;
+    double              ReplaySavedTimestep;    // FixedTimestep before the replay
+
+    std::atomic<int>    FrameDrawCalls;
+    std::atomic<int>    FrameDrawCallsUnbatched;
+};
+
+#endif // ENGINE_H
@@ -0,0 +1,268 @@
+//                        MIT License
+//
+//                  Copyright (c) 2024 Toby
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////
+/*                  FrameGraph.h
+
+          Runs the systems of a frame as a DAG on
+          the job system.
+
+          Systems declare the resources they read and
+          write. A system depends on every earlier
+          system it conflicts with (write/read,
+          read/write or write/write), everything else
+          runs concurrently. The critical path is
+          measured every frame.
+*/
+////////////////////////////////////////////////
+
+#ifndef FRAME_GRAPH_H
+#define FRAME_GRAPH_H
+
+#include "Jobs.h"
+#include "Object.h"     // HashStr
+#include "Profiler.h"
+
+#include <chrono>
+
+#define FRAME_GRAPH_MAX_RESOURCES   8   // Per system, per access kind
+
+typedef void (*FrameSystemFunc)(void* user_data);
+
+struct FrameSystem
+{
+    const char*         Name;
+    FrameSystemFunc     Func;
+    void*               UserData;
+    int                 Affinity;                           // JOB_AFFINITY_MAIN for systems touching the GL context
+    uint32              Reads[FRAME_GRAPH_MAX_RESOURCES];   // HashStr() of the resource names
+    uint32              Writes[FRAME_GRAPH_MAX_RESOURCES];
+    int                 ReadCount;
+    int                 WriteCount;
+
+    // Built by compile()
+    TArray<int>         Dependents;
+    int                 DependencyCount;
+
+    // Per frame
+    std::atomic<int32>  Remaining;
+    double              StartMs;
+    double              DurationMs;
+
+    FrameSystem() : Name(nullptr), Func(nullptr), UserData(nullptr), Affinity(JOB_AFFINITY_ANY), ReadCount(0), WriteCount(0), DependencyCount(0), Remaining(0), StartMs(0.0), DurationMs(0.0) {}
+    FrameSystem(const FrameSystem& other) : Name(other.Name), Func(other.Func), UserData(other.UserData), Affinity(other.Affinity), ReadCount(other.ReadCount), WriteCount(other.WriteCount),
+        Dependents(other.Dependents), DependencyCount(other.DependencyCount), Remaining(other.Remaining.load()), StartMs(other.StartMs), DurationMs(other.DurationMs) {
+        memcpy(Reads, other.Reads, sizeof(Reads));
+        memcpy(Writes, other.Writes, sizeof(Writes));
+    }
+};
+
+struct FrameGraphStats
+{
+    double          FrameMs;            // Wall time of execute()
+    double          CriticalPathMs;     // Longest dependency chain, the frame can't be faster than this
+    TArray<int>     CriticalPath;       // System indices, first to last
+    int             ThreadCount;
+};
+
+class FrameGraph
+{
+public:
+    // Chainable: graph.add_system("Physics", func, data).read("Nodes").write("Physics");
+    struct SystemBuilder
+    {
+        FrameGraph* Graph;
+        int         Index;
+
+        SystemBuilder& read(const char* resource)  { FrameSystem& s = Graph->Systems[Index]; assert(s.ReadCount < FRAME_GRAPH_MAX_RESOURCES); s.Reads[s.ReadCount++] = HashStr(resource); Graph->Compiled = false; return *this; }
+        SystemBuilder& write(const char* resource) { FrameSystem& s = Graph->Systems[Index]; assert(s.WriteCount < FRAME_GRAPH_MAX_RESOURCES); s.Writes[s.WriteCount++] = HashStr(resource); Graph->Compiled = false; return *this; }
+        SystemBuilder& main_thread()               { Graph->Systems[Index].Affinity = JOB_AFFINITY_MAIN; return *this; }
+    };
+
+    FrameGraph() : Compiled(false), Jobs(nullptr), SystemJobs(nullptr) {
+        Stats.FrameMs = 0.0;
+        Stats.CriticalPathMs = 0.0;
+        Stats.ThreadCount = 0;
+    }
+
+    // Systems added earlier run first when they conflict. 'func' may be null (placeholder phase).
+    SystemBuilder add_system(const char* name, FrameSystemFunc func, void* user_data) {
+        FrameSystem s;
+        s.Name = name;
+        s.Func = func;
+        s.UserData = user_data;
+        Systems.push_back(s);
+        Compiled = false;
+        SystemBuilder b = { this, Systems.size() - 1 };
+        return b;
+    }
+
+    // Rebinds the callback of an existing system without rebuilding the graph.
+    void set_system_func(int index, FrameSystemFunc func, void* user_data) {
+        Systems[index].Func = func;
+        Systems[index].UserData = user_data;
+    }
+
+    int find_system(const char* name) const {
+        for (int i = 0; i < Systems.size(); i++)
+            if (strcmp(Systems[i].Name, name) == 0)
+                return i;
+        return -1;
+    }
+
+    void clear() {
+        Systems.clear();
+        Stats.CriticalPath.clear();
+        Compiled = false;
+    }
+
+    int                 get_system_count() const        { return Systems.size(); }
+    const FrameSystem&  get_system(int index) const     { return Systems[index]; }
+    const FrameGraphStats& get_stats() const            { return Stats; }
+
+    void compile() {
+        for (int i = 0; i < Systems.size(); i++) {
+            Systems[i].Dependents.clear();
+            Systems[i].DependencyCount = 0;
+        }
+        for (int i = 0; i < Systems.size(); i++) {
+            for (int j = 0; j < i; j++) {
+                if (conflicts(Systems[j], Systems[i])) {
+                    Systems[j].Dependents.push_back(i);
+                    Systems[i].DependencyCount++;
+                }
+            }
+        }
+        Compiled = true;
+    }
+
+    // Runs every system once, returns when all are done.
+    void execute(JobSystem& jobs) {
+        if (!Compiled)
+            compile();
+
+        Jobs = &jobs;
+        FrameStart = std::chrono::steady_clock::now();
+        for (int i = 0; i < Systems.size(); i++)
+            Systems[i].Remaining.store(Systems[i].DependencyCount, std::memory_order_relaxed);
+
+        TArray<SystemJob> job_data;
+        job_data.resize(Systems.size());
+        SystemJobs = job_data.begin();
+        for (int i = 0; i < Systems.size(); i++) {
+            job_data[i].Graph = this;
+            job_data[i].Index = i;
+        }
+        for (int i = 0; i < Systems.size(); i++)
+            if (Systems[i].DependencyCount == 0)
+                jobs.submit(&FrameGraph::run_system, &job_data[i], &FrameCounter, Systems[i].Affinity);
+        jobs.wait(&FrameCounter);
+
+        Stats.FrameMs = elapsed_ms();
+        Stats.ThreadCount = jobs.get_thread_count();
+        compute_critical_path();
+        SystemJobs = nullptr;
+        Jobs = nullptr;
+    }
+
+private:
+    struct SystemJob
+    {
+        FrameGraph* Graph;
+        int         Index;
+    };
+
+    static bool intersects(const uint32* a, int a_count, const uint32* b, int b_count) {
+        for (int i = 0; i < a_count; i++)
+            for (int j = 0; j < b_count; j++)
+                if (a[i] == b[j])
+                    return true;
+        return false;
+    }
+
+    // 'first' was added before 'second'
+    static bool conflicts(const FrameSystem& first, const FrameSystem& second) {
+        return intersects(first.Writes, first.WriteCount, second.Reads, second.ReadCount)
+            || intersects(first.Writes, first.WriteCount, second.Writes, second.WriteCount)
+            || intersects(first.Reads, first.ReadCount, second.Writes, second.WriteCount);
+    }
+
+    double elapsed_ms() const { return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - FrameStart).count(); }
+
+    static void run_system(void* data) {
+        SystemJob* job = (SystemJob*)data;
+        FrameGraph* graph = job->Graph;
+        FrameSystem& s = graph->Systems[job->Index];
+
+        s.StartMs = graph->elapsed_ms();
+        if (s.Func) {
+            PROFILE_SCOPE(s.Name);
+            s.Func(s.UserData);
+        }
+        s.DurationMs = graph->elapsed_ms() - s.StartMs;
+
+        for (int i = 0; i < s.Dependents.size(); i++) {
+            const int d = s.Dependents[i];
+            if (graph->Systems[d].Remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                graph->Jobs->submit(&FrameGraph::run_system, &graph->SystemJobs[d], &graph->FrameCounter, graph->Systems[d].Affinity);
+        }
+    }
+
+    // Systems are stored in a valid topological order (edges only go forward).
+    void compute_critical_path() {
+        const int count = Systems.size();
+        TArray<double> finish;
+        TArray<int> previous;
+        finish.resize(count, 0.0);
+        previous.resize(count, -1);
+
+        int last = -1;
+        for (int i = 0; i < count; i++) {
+            finish[i] += Systems[i].DurationMs;
+            for (int k = 0; k < Systems[i].Dependents.size(); k++) {
+                const int d = Systems[i].Dependents[k];
+                if (finish[i] > finish[d]) {
+                    finish[d] = finish[i];
+                    previous[d] = i;
+                }
+            }
+            if (last < 0 || finish[i] > finish[last])
+                last = i;
+        }
+
+        Stats.CriticalPath.clear();
+        Stats.CriticalPathMs = last >= 0 ? finish[last] : 0.0;
+        for (int i = last; i >= 0; i = previous[i])
+            Stats.CriticalPath.push_front(i);
+    }
+
+    TArray<FrameSystem>                     Systems;
+    bool                                    Compiled;
+    JobCounter                              FrameCounter;
+    JobSystem*                              Jobs;
+    SystemJob*                              SystemJobs;
+    std::chrono::steady_clock::time_point   FrameStart;
+    FrameGraphStats                         Stats;
+};
+
+#endif // FRAME_GRAPH_H
@@ -0,0 +1,206 @@
+//                        MIT License
+//
+//                  Copyright (c) 2024 Toby
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////
+/*                  FramePacer.h
+
+          Frame timing.
+
+          FramePacer   - holds a target frame rate.
+                         Sleeps for most of the wait,
+                         then spins the last stretch.
+                         The spin window adapts to how
+                         late the OS wakes us up, so a
+                         60 Hz server doesn't burn a core.
+                         Smoothed frame time and late
+                         frame counts for the overlay.
+          FixedStepper - fixed timestep accumulator,
+                         how many ticks to run this frame
+                         and the interpolation alpha for
+                         rendering between the last two.
+*/
+////////////////////////////////////////////////
+
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <string.h>     // memset
+#include <chrono>
+#include <thread>
+
+#define FRAME_PACER_SMOOTHING_FRAMES    16          // Frame times averaged for get_smoothed_delta()
+#define FRAME_PACER_MIN_SPIN_NS         200000ull   // 0.2 ms
+#define FRAME_PACER_MAX_SPIN_NS         4000000ull  // 4 ms, coarse timers (Windows without timeBeginPeriod)
+#define FRAME_PACER_LATE_TOLERANCE      0.1         // Of a period, finishing later than this counts as late
+
+#define FIXED_STEPPER_MAX_STEPS         8           // Per frame, beyond this time is dropped instead of spiralling
+
+struct FramePacerStats
+{
+    double  FrameMs;            // Last frame, begin to begin
+    double  SmoothedMs;         // Average of the last FRAME_PACER_SMOOTHING_FRAMES
+    double  MinMs;
+    double  MaxMs;
+    double  WaitMs;             // Slept + spun last frame
+    double  SpinMs;
+    double  OvershootMs;        // How late the last wake up was, averaged
+    uint64  Frames;
+    uint64  LateFrames;         // Work alone ran past the deadline
+};
+
+class FramePacer
+{
+public:
+    FramePacer() : PeriodNs(0), Deadline(0), LastBegin(0), SpinNs(1000000ull), OvershootNs(0.0), HistoryCount(0), HistoryIndex(0) {
+        Epoch = std::chrono::steady_clock::now();
+        memset(&Stats, 0, sizeof(Stats));
+        for (int i = 0; i < FRAME_PACER_SMOOTHING_FRAMES; i++)
+            History[i] = 0.0;
+    }
+
+    // 0 = unlimited, wait() returns at once.
+    void set_target_fps(double fps) {
+        PeriodNs = fps > 0.0 ? (uint64)(1e9 / fps + 0.5) : 0;
+        Deadline = 0;
+    }
+    double get_target_fps() const { return PeriodNs ? 1e9 / (double)PeriodNs : 0.0; }
+
+    // Start of a frame. Returns the seconds since the previous begin_frame(), 0 the first time.
+    double begin_frame() {
+        const uint64 now = now_ns();
+        const double dt = LastBegin ? (double)(now - LastBegin) * 1e-9 : 0.0;
+        LastBegin = now;
+        if (dt > 0.0) {
+            const double ms = dt * 1e3;
+            Stats.FrameMs = ms;
+            Stats.MinMs = Stats.Frames == 0 || ms < Stats.MinMs ? ms : Stats.MinMs;
+            Stats.MaxMs = ms > Stats.MaxMs ? ms : Stats.MaxMs;
+            History[HistoryIndex] = ms;
+            HistoryIndex = (HistoryIndex + 1) % FRAME_PACER_SMOOTHING_FRAMES;
+            HistoryCount += HistoryCount < FRAME_PACER_SMOOTHING_FRAMES ? 1 : 0;
+            double sum = 0.0;
+            for (int i = 0; i < HistoryCount; i++)
+                sum += History[i];
+            Stats.SmoothedMs = sum / HistoryCount;
+            Stats.Frames++;
+        }
+        return dt;
+    }
+
+    // End of a frame's work. Waits out the rest of the period.
+    void wait() {
+        if (!PeriodNs)
+            return;
+        const uint64 start = now_ns();
+        if (!Deadline)
+            Deadline = LastBegin ? LastBegin : start;
+        Deadline += PeriodNs;
+
+        if (start > Deadline + (uint64)(PeriodNs * FRAME_PACER_LATE_TOLERANCE)) {
+            // Late: start counting from now, catching up would only bunch frames together
+            Stats.LateFrames++;
+            Deadline = start;
+            Stats.WaitMs = Stats.SpinMs = 0.0;
+            return;
+        }
+
+        // Sleep while the OS can be trusted to wake us up in time
+        if (Deadline > start + SpinNs) {
+            const uint64 sleep_until = Deadline - SpinNs;
+            std::this_thread::sleep_for(std::chrono::nanoseconds(sleep_until - start));
+            const uint64 woke = now_ns();
+            const double overshoot = woke > sleep_until ? (double)(woke - sleep_until) : 0.0;
+            OvershootNs = OvershootNs * 0.9 + overshoot * 0.1;
+            // Spin a bit longer than the typical oversleep
+            uint64 spin = (uint64)(OvershootNs * 1.5) + FRAME_PACER_MIN_SPIN_NS;
+            SpinNs = spin < FRAME_PACER_MIN_SPIN_NS ? FRAME_PACER_MIN_SPIN_NS : spin > FRAME_PACER_MAX_SPIN_NS ? FRAME_PACER_MAX_SPIN_NS : spin;
+        }
+
+        const uint64 spin_start = now_ns();
+        uint64 now = spin_start;
+        while (now < Deadline) {
+            if (Deadline - now > 100000ull)
+                std::this_thread::yield();
+            now = now_ns();
+        }
+        Stats.SpinMs = (double)(now - spin_start) * 1e-6;
+        Stats.WaitMs = (double)(now - start) * 1e-6;
+        Stats.OvershootMs = OvershootNs * 1e-6;
+    }
+
+    double                  get_delta() const           { return Stats.FrameMs * 1e-3; }
+    double                  get_smoothed_delta() const  { return Stats.SmoothedMs * 1e-3; }
+    const FramePacerStats&  get_stats() const           { return Stats; }
+    void                    reset_stats()               { const double smoothed = Stats.SmoothedMs; memset(&Stats, 0, sizeof(Stats)); Stats.SmoothedMs = smoothed; }
+
+private:
+    uint64 now_ns() const { return (uint64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - Epoch).count() + 1; }
+
+    std::chrono::steady_clock::time_point   Epoch;
+    uint64              PeriodNs;
+    uint64              Deadline;
+    uint64              LastBegin;
+    uint64              SpinNs;
+    double              OvershootNs;
+    double              History[FRAME_PACER_SMOOTHING_FRAMES];
+    int                 HistoryCount;
+    int                 HistoryIndex;
+    FramePacerStats     Stats;
+};
+
+// const int steps = stepper.advance(dt);
+// for (int i = 0; i < steps; i++) physics_step(stepper.get_step());
+// render(lerp(previous, current, stepper.get_alpha()));
+class FixedStepper
+{
+public:
+    FixedStepper() : Step(1.0 / 60.0), Accumulator(0.0), Steps(0), DroppedTime(0.0) {}
+
+    void    set_ticks_per_second(int ticks)  { Step = ticks > 0 ? 1.0 / (double)ticks : Step; }
+    double  get_step() const                 { return Step; }
+
+    // Adds a frame's time, returns the number of fixed steps to run now.
+    int advance(double dt) {
+        Accumulator += dt;
+        int steps = (int)(Accumulator / Step);
+        Accumulator -= steps * Step;
+        if (steps > FIXED_STEPPER_MAX_STEPS) {
+            DroppedTime += (steps - FIXED_STEPPER_MAX_STEPS) * Step;
+            steps = FIXED_STEPPER_MAX_STEPS;
+        }
+        Steps = steps;
+        return Steps;
+    }
+
+    int     get_steps() const           { return Steps; }
+    double  get_alpha() const           { return Accumulator / Step; }     // 0..1, how far past the last step the frame is
+    double  get_dropped_time() const    { return DroppedTime; }
+
+private:
+    double  Step;
+    double  Accumulator;
+    int     Steps;
+    double  DroppedTime;
+};
+
+#endif // FRAME_PACER_H
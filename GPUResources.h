@@ -0,0 +1,421 @@
+//                        MIT License
+//
+//                  Copyright (c) 2024 Toby
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////
+/*                  GPUResources.h
+
+          GPU objects shared by every window of a
+          share group (Moss_CreateWindow(..., share)
+          and Moss_CreatePopup()).
+
+          Textures, shaders, font atlases and buffers
+          live in the shared context: uploaded once
+          by name, reference counted, destroyed when
+          the last reference goes.
+
+          Vertex arrays are container objects and are
+          NOT shared between contexts, so they are
+          created lazily, one per window that draws
+          the buffer, and destroyed with the window.
+
+          GPUSharedResources* res = window->Resources;
+          GPUResourceHandle atlas = res->acquire_font_atlas("ui_font", desc);
+          uint32 vao = res->get_vertex_array(window, quad, quad_indices, &Quad_Layout);
+          ...
+          res->release(atlas);
+
+          The platform layer owns the registry, see
+          Platform.h. Headless windows use the null
+          backend: ids are counted, nothing is uploaded.
+
+          GL shaders compile through ShaderCache.h
+          (ShaderGL_Compile()), the engine has one
+          compile and link path. With
+          set_shader_cache(), acquire_shader() also
+          loads and saves program binaries.
+*/
+////////////////////////////////////////////////
+
+#ifndef GPU_RESOURCES_H
+#define GPU_RESOURCES_H
+
+#include "Variants.h"
+#include "Object.h"     // HashStr
+#include "Memory.h"     // GetMemoryTracker, MEMORY_TAG_TEXTURES
+
+#if defined(MOSS_GPU_RESOURCES_GL) && !defined(MOSS_SHADER_CACHE_GL)
+#ifdef SHADER_CACHE_H
+#error "ShaderCache.h was included without MOSS_SHADER_CACHE_GL, GPUResources.h compiles shaders through it"
+#endif
+#define MOSS_SHADER_CACHE_GL
+#endif
+#include "ShaderCache.h"    // ShaderGL_Compile()
+
+#include <string.h>     // memcpy, memset, strcmp, strlen
+
+struct Moss_window;
+
+#define GPU_RESOURCE_TEXTURE        0
+#define GPU_RESOURCE_FONT_ATLAS     1       // Single channel texture
+#define GPU_RESOURCE_SHADER         2       // Linked program
+#define GPU_RESOURCE_BUFFER         3       // Vertex or index data
+#define GPU_RESOURCE_TYPE_COUNT     4
+
+#define GPU_RESOURCE_BACKEND_GL     0
+#define GPU_RESOURCE_BACKEND_NULL   1
+
+typedef int GPUResourceHandle;              // -1 = none
+typedef void (*GPUVertexLayoutFunc)(void);  // Sets the attribute pointers, the vertex array and buffers are bound
+
+struct GPUTextureDesc
+{
+    int             Width;
+    int             Height;
+    int             Channels;       // 1 (font atlas) or 4
+    const void*     Pixels;
+};
+
+struct GPUShaderDesc
+{
+    const char*     Vertex;
+    const char*     Fragment;
+};
+
+struct GPUBufferDesc
+{
+    const void*     Data;
+    size_t          Size;
+    bool            Indices;        // Element array buffer
+};
+
+// Creates objects in the current context. Only vertex arrays care which one that is.
+struct GPUResourceBackend
+{
+    const char*     Name;
+    uint32          (*upload_texture)(const GPUTextureDesc& desc);
+    uint32          (*upload_shader)(const GPUShaderDesc& desc);
+    uint32          (*upload_buffer)(const GPUBufferDesc& desc);
+    void            (*destroy)(int type, uint32 id);
+    uint32          (*create_vertex_array)(uint32 buffer, uint32 indices, GPUVertexLayoutFunc layout);
+    void            (*destroy_vertex_array)(uint32 id);
+};
+
+struct GPUResource
+{
+    uint32          Key;            // HashStr() of the name
+    char*           Name;           // Own copy, MEMORY_TAG_GENERAL, confirms a Key match
+    int             Type;
+    uint32          Id;             // GL name, 0 for a free slot
+    int             RefCount;
+    size_t          Bytes;
+};
+
+struct GPUVertexArray
+{
+    const Moss_window*  Window;     // Context it was created in
+    GPUResourceHandle   Buffer;
+    GPUResourceHandle   Indices;
+    uint32              Id;
+    bool                Dead;       // A buffer went away, deleted the next time the window collects
+};
+
+struct GPUResourceStats
+{
+    uint64  Uploads[GPU_RESOURCE_TYPE_COUNT];
+    uint64  Reuses;                 // acquire() that found the resource already uploaded
+    uint64  Destroys;
+    uint64  VertexArraysCreated;
+    uint64  VertexArraysDestroyed;
+    int     LiveResources;
+    int     LiveVertexArrays;
+    int     Windows;
+    size_t  LiveBytes;              // Textures and buffers, estimated from the descs
+};
+
+class GPUSharedResources
+{
+public:
+    explicit GPUSharedResources(const GPUResourceBackend* backend) : Backend(backend), Shaders(nullptr) { memset(&Stats, 0, sizeof(Stats)); }
+    ~GPUSharedResources() { destroy_all(); }
+
+    void attach(const Moss_window*) { Stats.Windows++; }
+
+    // Call with the window's context current. Returns true when it was the last window:
+    // everything left has been destroyed and the registry can be deleted.
+    bool detach(const Moss_window* window) {
+        for (int i = VertexArrays.size() - 1; i >= 0; i--)
+            if (VertexArrays[i].Window == window)
+                destroy_vertex_array(i);
+        if (--Stats.Windows > 0)
+            return false;
+        destroy_all();
+        return true;
+    }
+
+    GPUResourceHandle acquire_texture(const char* name, const GPUTextureDesc& desc) {
+        GPUResourceHandle handle = find_and_retain(name, GPU_RESOURCE_TEXTURE);
+        return handle >= 0 ? handle : add(name, GPU_RESOURCE_TEXTURE, Backend->upload_texture(desc), (size_t)desc.Width * desc.Height * desc.Channels);
+    }
+
+    GPUResourceHandle acquire_font_atlas(const char* name, const GPUTextureDesc& desc) {
+        GPUResourceHandle handle = find_and_retain(name, GPU_RESOURCE_FONT_ATLAS);
+        return handle >= 0 ? handle : add(name, GPU_RESOURCE_FONT_ATLAS, Backend->upload_texture(desc), (size_t)desc.Width * desc.Height * desc.Channels);
+    }
+
+    GPUResourceHandle acquire_shader(const char* name, const GPUShaderDesc& desc) {
+        GPUResourceHandle handle = find_and_retain(name, GPU_RESOURCE_SHADER);
+        if (handle >= 0)
+            return handle;
+        const uint32 id = Shaders ? Shaders->build_program(name, desc.Vertex, desc.Fragment) : Backend->upload_shader(desc);
+        return add(name, GPU_RESOURCE_SHADER, id, 0);
+    }
+
+    // Shaders acquired from now on go through 'shaders' and its binary cache, nullptr to stop.
+    // Its backend must match this one's (both GL or both null), the programs stay ours to destroy.
+    void set_shader_cache(ShaderCache* shaders) { Shaders = shaders; }
+
+    GPUResourceHandle acquire_buffer(const char* name, const GPUBufferDesc& desc) {
+        GPUResourceHandle handle = find_and_retain(name, GPU_RESOURCE_BUFFER);
+        return handle >= 0 ? handle : add(name, GPU_RESOURCE_BUFFER, Backend->upload_buffer(desc), desc.Size);
+    }
+
+    // Without a reference, -1 if it isn't uploaded.
+    GPUResourceHandle find(const char* name, int type) const {
+        const uint32 key = HashStr(name);
+        for (int i = 0; i < Resources.size(); i++)
+            if (Resources[i].Id && Resources[i].Key == key && Resources[i].Type == type && strcmp(Resources[i].Name, name) == 0)
+                return i;
+        return -1;
+    }
+
+    void retain(GPUResourceHandle handle) { assert(is_valid(handle)); Resources[handle].RefCount++; }
+
+    void release(GPUResourceHandle handle) {
+        assert(is_valid(handle));
+        if (--Resources[handle].RefCount > 0)
+            return;
+        if (Resources[handle].Type == GPU_RESOURCE_BUFFER) {
+            // Other contexts' vertex arrays can't be deleted from here
+            for (int i = 0; i < VertexArrays.size(); i++)
+                if (VertexArrays[i].Buffer == handle || VertexArrays[i].Indices == handle)
+                    VertexArrays[i].Dead = true;
+        }
+        destroy_resource(handle);
+    }
+
+    uint32  get_id(GPUResourceHandle handle) const      { return is_valid(handle) ? Resources[handle].Id : 0; }
+    int     get_ref_count(GPUResourceHandle handle) const { return is_valid(handle) ? Resources[handle].RefCount : 0; }
+    bool    is_valid(GPUResourceHandle handle) const    { return handle >= 0 && handle < Resources.size() && Resources[handle].Id != 0; }
+
+    // The window's vertex array for the buffers, created on first use. Call with the window's context current.
+    uint32 get_vertex_array(const Moss_window* window, GPUResourceHandle buffer, GPUResourceHandle indices, GPUVertexLayoutFunc layout) {
+        assert(is_valid(buffer));
+        for (int i = 0; i < VertexArrays.size(); i++) {
+            const GPUVertexArray& vao = VertexArrays[i];
+            if (vao.Window == window && vao.Buffer == buffer && vao.Indices == indices && !vao.Dead)
+                return vao.Id;
+        }
+        GPUVertexArray vao;
+        vao.Window = window;
+        vao.Buffer = buffer;
+        vao.Indices = indices;
+        vao.Id = Backend->create_vertex_array(Resources[buffer].Id, get_id(indices), layout);
+        vao.Dead = false;
+        VertexArrays.push_back(vao);
+        Stats.VertexArraysCreated++;
+        Stats.LiveVertexArrays++;
+        return vao.Id;
+    }
+
+    // Deletes the window's vertex arrays whose buffers were released. Call with the window's context current.
+    void collect(const Moss_window* window) {
+        for (int i = VertexArrays.size() - 1; i >= 0; i--)
+            if (VertexArrays[i].Window == window && VertexArrays[i].Dead)
+                destroy_vertex_array(i);
+    }
+
+    const GPUResourceBackend*   get_backend() const { return Backend; }
+    const GPUResourceStats&     get_stats() const   { return Stats; }
+
+private:
+    GPUResourceHandle find_and_retain(const char* name, int type) {
+        const GPUResourceHandle handle = find(name, type);
+        if (handle >= 0) {
+            Resources[handle].RefCount++;
+            Stats.Reuses++;
+        }
+        return handle;
+    }
+
+    GPUResourceHandle add(const char* name, int type, uint32 id, size_t bytes) {
+        if (!id)
+            return -1;
+        const size_t name_size = strlen(name) + 1;
+        GPUResource resource;
+        resource.Key = HashStr(name);
+        resource.Name = (char*)Memory_Alloc(name_size);
+        memcpy(resource.Name, name, name_size);
+        resource.Type = type;
+        resource.Id = id;
+        resource.RefCount = 1;
+        resource.Bytes = bytes;
+        // Reuse a free slot, handles stay small and stable
+        GPUResourceHandle handle = -1;
+        for (int i = 0; i < Resources.size() && handle < 0; i++)
+            if (!Resources[i].Id)
+                handle = i;
+        if (handle < 0) {
+            handle = Resources.size();
+            Resources.push_back(resource);
+        }
+        else {
+            Resources[handle] = resource;
+        }
+        if (type == GPU_RESOURCE_TEXTURE || type == GPU_RESOURCE_FONT_ATLAS)
+            GetMemoryTracker().on_alloc(MEMORY_TAG_TEXTURES, bytes);
+        Stats.Uploads[type]++;
+        Stats.LiveResources++;
+        Stats.LiveBytes += bytes;
+        return handle;
+    }
+
+    void destroy_resource(GPUResourceHandle handle) {
+        GPUResource& resource = Resources[handle];
+        Backend->destroy(resource.Type, resource.Id);
+        if (resource.Type == GPU_RESOURCE_TEXTURE || resource.Type == GPU_RESOURCE_FONT_ATLAS)
+            GetMemoryTracker().on_free(MEMORY_TAG_TEXTURES, resource.Bytes);
+        Stats.Destroys++;
+        Stats.LiveResources--;
+        Stats.LiveBytes -= resource.Bytes;
+        Memory_Free(resource.Name);
+        resource.Name = nullptr;
+        resource.Id = 0;
+        resource.RefCount = 0;
+    }
+
+    void destroy_vertex_array(int index) {
+        Backend->destroy_vertex_array(VertexArrays[index].Id);
+        VertexArrays[index] = VertexArrays.back();
+        VertexArrays.pop_back();
+        Stats.VertexArraysDestroyed++;
+        Stats.LiveVertexArrays--;
+    }
+
+    // Last window gone, references still held don't matter anymore.
+    void destroy_all() {
+        while (VertexArrays.size())
+            destroy_vertex_array(VertexArrays.size() - 1);
+        for (int i = 0; i < Resources.size(); i++)
+            if (Resources[i].Id)
+                destroy_resource(i);
+        Resources.clear();
+        VertexArrays.clear();
+    }
+
+    const GPUResourceBackend*   Backend;
+    ShaderCache*                Shaders;        // Optional, see set_shader_cache()
+    TArray<GPUResource>         Resources;
+    TArray<GPUVertexArray>      VertexArrays;
+    GPUResourceStats            Stats;
+};
+
+// Null: hands out increasing ids so handles and counts behave, uploads nothing.
+static inline uint32 GPUNull_NextId()                                                  { static uint32 next = 0; return ++next; }
+static inline uint32 GPUNull_UploadTexture(const GPUTextureDesc&)                      { return GPUNull_NextId(); }
+static inline uint32 GPUNull_UploadShader(const GPUShaderDesc&)                        { return GPUNull_NextId(); }
+static inline uint32 GPUNull_UploadBuffer(const GPUBufferDesc&)                        { return GPUNull_NextId(); }
+static inline void   GPUNull_Destroy(int, uint32)                                      {}
+static inline uint32 GPUNull_CreateVertexArray(uint32, uint32, GPUVertexLayoutFunc)    { return GPUNull_NextId(); }
+static inline void   GPUNull_DestroyVertexArray(uint32)                                {}
+
+#ifdef MOSS_GPU_RESOURCES_GL
+#include "thirdparty/glad/glad.h"
+
+static inline uint32 GPUGL_UploadTexture(const GPUTextureDesc& desc) {
+    GLuint id = 0;
+    glGenTextures(1, &id);
+    glBindTexture(GL_TEXTURE_2D, id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    const GLenum format = desc.Channels == 1 ? GL_RED : GL_RGBA;
+    glTexImage2D(GL_TEXTURE_2D, 0, desc.Channels == 1 ? GL_R8 : GL_RGBA8, desc.Width, desc.Height, 0, format, GL_UNSIGNED_BYTE, desc.Pixels);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return id;
+}
+
+static inline uint32 GPUGL_UploadShader(const GPUShaderDesc& desc) { return ShaderGL_Compile(desc.Vertex, desc.Fragment); }
+
+static inline uint32 GPUGL_UploadBuffer(const GPUBufferDesc& desc) {
+    const GLenum target = desc.Indices ? GL_ELEMENT_ARRAY_BUFFER : GL_ARRAY_BUFFER;
+    GLuint id = 0;
+    glGenBuffers(1, &id);
+    glBindBuffer(target, id);
+    glBufferData(target, (GLsizeiptr)desc.Size, desc.Data, GL_STATIC_DRAW);
+    glBindBuffer(target, 0);
+    return id;
+}
+
+static inline void GPUGL_Destroy(int type, uint32 id) {
+    GLuint name = id;
+    if (type == GPU_RESOURCE_SHADER)
+        glDeleteProgram(name);
+    else if (type == GPU_RESOURCE_BUFFER)
+        glDeleteBuffers(1, &name);
+    else
+        glDeleteTextures(1, &name);
+}
+
+static inline uint32 GPUGL_CreateVertexArray(uint32 buffer, uint32 indices, GPUVertexLayoutFunc layout) {
+    GLuint id = 0;
+    glGenVertexArrays(1, &id);
+    glBindVertexArray(id);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    if (indices)
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices);
+    if (layout)
+        layout();
+    glBindVertexArray(0);
+    return id;
+}
+
+static inline void GPUGL_DestroyVertexArray(uint32 id) { GLuint name = id; glDeleteVertexArrays(1, &name); }
+#endif // MOSS_GPU_RESOURCES_GL
+
+// GL needs MOSS_GPU_RESOURCES_GL (glad), without it GL falls back to the null backend.
+static inline const GPUResourceBackend* GetGPUResourceBackend(int type) {
+    static const GPUResourceBackend null_backend = {
+        "Null", GPUNull_UploadTexture, GPUNull_UploadShader, GPUNull_UploadBuffer, GPUNull_Destroy, GPUNull_CreateVertexArray, GPUNull_DestroyVertexArray
+    };
+#ifdef MOSS_GPU_RESOURCES_GL
+    static const GPUResourceBackend gl_backend = {
+        "GL", GPUGL_UploadTexture, GPUGL_UploadShader, GPUGL_UploadBuffer, GPUGL_Destroy, GPUGL_CreateVertexArray, GPUGL_DestroyVertexArray
+    };
+    if (type == GPU_RESOURCE_BACKEND_GL)
+        return &gl_backend;
+#endif
+    (void)type;
+    return &null_backend;
+}
+
+#endif // GPU_RESOURCES_H
@@ -0,0 +1,294 @@
+//                        MIT License
+//
+//                  Copyright (c) 2024 Toby
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////
+/*                  GPUState.h
+
+          Shadow copy of the GL state a frame keeps
+          changing: bound program, textures per unit,
+          vertex array, blend, depth and scissor.
+
+          Every set/bind compares against the copy and
+          only reaches GL when the value changes, so
+          nodes can bind what they need without caring
+          what the previous node left bound.
+
+          GPUStateCache state(GetGPUStateBackend(GPU_STATE_BACKEND_GL));
+          state.use_program(shader);
+          state.bind_texture(0, GL_TEXTURE_2D, atlas);
+          state.set_blend(true);
+          state.set_blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+          GL state is per context: one cache per window.
+          Code that calls GL behind the cache's back
+          (GPUResources.h uploads bind textures) must
+          call invalidate() afterwards, the next set of
+          each value is then always issued.
+
+          get_stats() counts issued and skipped calls.
+          MockGL.h (test only) has a loader that stands
+          in for the driver, so the GL backend runs
+          headless.
+*/
+////////////////////////////////////////////////
+
+#ifndef GPU_STATE_H
+#define GPU_STATE_H
+
+#include "Variants.h"
+
+#include <string.h>     // memset
+
+#define GPU_STATE_BACKEND_GL        0
+#define GPU_STATE_BACKEND_NULL      1
+
+#define GPU_STATE_MAX_TEXTURE_UNITS 16
+
+#define GPU_STATE_CAP_BLEND         0
+#define GPU_STATE_CAP_DEPTH_TEST    1
+#define GPU_STATE_CAP_SCISSOR_TEST  2
+#define GPU_STATE_CAP_COUNT         3
+
+// Never a valid GL name or enum: the cached value is unknown
+#define GPU_STATE_UNKNOWN           0xFFFFFFFFu
+
+// Enums are passed through untouched, they are GL's (GL_SRC_ALPHA, GL_LEQUAL, ...).
+struct GPUStateBackend
+{
+    const char*     Name;
+    void            (*use_program)(uint32 program);
+    void            (*active_texture)(int unit);
+    void            (*bind_texture)(uint32 target, uint32 texture);
+    void            (*bind_vertex_array)(uint32 vertex_array);
+    void            (*set_capability)(int cap, bool enabled);
+    void            (*blend_func)(uint32 src_rgb, uint32 dst_rgb, uint32 src_alpha, uint32 dst_alpha);
+    void            (*blend_equation)(uint32 mode);
+    void            (*depth_func)(uint32 func);
+    void            (*depth_mask)(bool write);
+    void            (*scissor)(int x, int y, int width, int height);
+};
+
+struct GPUStateStats
+{
+    uint64  Issued;                 // Calls that reached the backend
+    uint64  Skipped;                // Calls filtered because the value was already set
+};
+
+class GPUStateCache
+{
+public:
+    GPUStateCache(const GPUStateBackend* backend) : Backend(backend) {
+        memset(&Stats, 0, sizeof(Stats));
+        invalidate();
+    }
+
+    // Forget everything, for a new context or after GL calls that bypassed the cache.
+    void invalidate() {
+        Program = GPU_STATE_UNKNOWN;
+        ActiveUnit = -1;
+        for (int i = 0; i < GPU_STATE_MAX_TEXTURE_UNITS; i++) {
+            Textures[i] = GPU_STATE_UNKNOWN;
+            TextureTargets[i] = GPU_STATE_UNKNOWN;
+        }
+        VertexArray = GPU_STATE_UNKNOWN;
+        for (int i = 0; i < GPU_STATE_CAP_COUNT; i++)
+            Caps[i] = -1;
+        for (int i = 0; i < 4; i++)
+            BlendFunc[i] = GPU_STATE_UNKNOWN;
+        BlendEquation = GPU_STATE_UNKNOWN;
+        DepthFunc = GPU_STATE_UNKNOWN;
+        DepthWrite = -1;
+        ScissorKnown = false;
+    }
+
+    void use_program(uint32 program) {
+        if (!changed(Program != program))
+            return;
+        Program = program;
+        Backend->use_program(program);
+    }
+
+    // Only switches the active unit when the binding actually changes.
+    void bind_texture(int unit, uint32 target, uint32 texture) {
+        assert(unit >= 0 && unit < GPU_STATE_MAX_TEXTURE_UNITS);
+        if (!changed(Textures[unit] != texture || TextureTargets[unit] != target))
+            return;
+        if (ActiveUnit != unit) {
+            ActiveUnit = unit;
+            Backend->active_texture(unit);
+            Stats.Issued++;
+        }
+        Textures[unit] = texture;
+        TextureTargets[unit] = target;
+        Backend->bind_texture(target, texture);
+    }
+
+    void bind_vertex_array(uint32 vertex_array) {
+        if (!changed(VertexArray != vertex_array))
+            return;
+        VertexArray = vertex_array;
+        Backend->bind_vertex_array(vertex_array);
+    }
+
+    void set_blend(bool enabled)           { set_capability(GPU_STATE_CAP_BLEND, enabled); }
+    void set_depth_test(bool enabled)      { set_capability(GPU_STATE_CAP_DEPTH_TEST, enabled); }
+    void set_scissor_test(bool enabled)    { set_capability(GPU_STATE_CAP_SCISSOR_TEST, enabled); }
+
+    void set_blend_func(uint32 src, uint32 dst) { set_blend_func(src, dst, src, dst); }
+    void set_blend_func(uint32 src_rgb, uint32 dst_rgb, uint32 src_alpha, uint32 dst_alpha) {
+        if (!changed(BlendFunc[0] != src_rgb || BlendFunc[1] != dst_rgb || BlendFunc[2] != src_alpha || BlendFunc[3] != dst_alpha))
+            return;
+        BlendFunc[0] = src_rgb;
+        BlendFunc[1] = dst_rgb;
+        BlendFunc[2] = src_alpha;
+        BlendFunc[3] = dst_alpha;
+        Backend->blend_func(src_rgb, dst_rgb, src_alpha, dst_alpha);
+    }
+
+    void set_blend_equation(uint32 mode) {
+        if (!changed(BlendEquation != mode))
+            return;
+        BlendEquation = mode;
+        Backend->blend_equation(mode);
+    }
+
+    void set_depth_func(uint32 func) {
+        if (!changed(DepthFunc != func))
+            return;
+        DepthFunc = func;
+        Backend->depth_func(func);
+    }
+
+    void set_depth_write(bool write) {
+        if (!changed(DepthWrite != (write ? 1 : 0)))
+            return;
+        DepthWrite = write ? 1 : 0;
+        Backend->depth_mask(write);
+    }
+
+    void set_scissor(int x, int y, int width, int height) {
+        if (!changed(!ScissorKnown || Scissor[0] != x || Scissor[1] != y || Scissor[2] != width || Scissor[3] != height))
+            return;
+        ScissorKnown = true;
+        Scissor[0] = x;
+        Scissor[1] = y;
+        Scissor[2] = width;
+        Scissor[3] = height;
+        Backend->scissor(x, y, width, height);
+    }
+
+    uint32 get_program() const                  { return Program; }
+    uint32 get_texture(int unit) const          { return Textures[unit]; }
+    uint32 get_vertex_array() const             { return VertexArray; }
+    const GPUStateBackend* get_backend() const  { return Backend; }
+
+    const GPUStateStats& get_stats() const      { return Stats; }
+    void reset_stats()                          { memset(&Stats, 0, sizeof(Stats)); }
+
+private:
+    bool changed(bool differs) {
+        if (differs)
+            Stats.Issued++;
+        else
+            Stats.Skipped++;
+        return differs;
+    }
+
+    void set_capability(int cap, bool enabled) {
+        if (!changed(Caps[cap] != (enabled ? 1 : 0)))
+            return;
+        Caps[cap] = enabled ? 1 : 0;
+        Backend->set_capability(cap, enabled);
+    }
+
+    const GPUStateBackend*  Backend;
+    uint32                  Program;
+    int                     ActiveUnit;                             // -1 = unknown
+    uint32                  Textures[GPU_STATE_MAX_TEXTURE_UNITS];
+    uint32                  TextureTargets[GPU_STATE_MAX_TEXTURE_UNITS];
+    uint32                  VertexArray;
+    int                     Caps[GPU_STATE_CAP_COUNT];              // -1 = unknown, 0, 1
+    uint32                  BlendFunc[4];
+    uint32                  BlendEquation;
+    uint32                  DepthFunc;
+    int                     DepthWrite;                             // -1 = unknown, 0, 1
+    int                     Scissor[4];
+    bool                    ScissorKnown;
+    GPUStateStats           Stats;
+};
+
+static inline void GPUStateNull_UseProgram(uint32)                          {}
+static inline void GPUStateNull_ActiveTexture(int)                          {}
+static inline void GPUStateNull_BindTexture(uint32, uint32)                 {}
+static inline void GPUStateNull_BindVertexArray(uint32)                     {}
+static inline void GPUStateNull_SetCapability(int, bool)                    {}
+static inline void GPUStateNull_BlendFunc(uint32, uint32, uint32, uint32)   {}
+static inline void GPUStateNull_BlendEquation(uint32)                       {}
+static inline void GPUStateNull_DepthFunc(uint32)                           {}
+static inline void GPUStateNull_DepthMask(bool)                             {}
+static inline void GPUStateNull_Scissor(int, int, int, int)                 {}
+
+#ifdef MOSS_GPU_STATE_GL
+#include "thirdparty/glad/glad.h"
+
+static inline void GPUStateGL_UseProgram(uint32 program)                { glUseProgram(program); }
+static inline void GPUStateGL_ActiveTexture(int unit)                   { glActiveTexture(GL_TEXTURE0 + unit); }
+static inline void GPUStateGL_BindTexture(uint32 target, uint32 texture) { glBindTexture(target, texture); }
+static inline void GPUStateGL_BindVertexArray(uint32 vertex_array)      { glBindVertexArray(vertex_array); }
+static inline void GPUStateGL_BlendEquation(uint32 mode)                { glBlendEquation(mode); }
+static inline void GPUStateGL_DepthFunc(uint32 func)                    { glDepthFunc(func); }
+static inline void GPUStateGL_DepthMask(bool write)                     { glDepthMask(write ? GL_TRUE : GL_FALSE); }
+static inline void GPUStateGL_Scissor(int x, int y, int width, int height) { glScissor(x, y, width, height); }
+
+static inline void GPUStateGL_SetCapability(int cap, bool enabled) {
+    static const GLenum caps[GPU_STATE_CAP_COUNT] = { GL_BLEND, GL_DEPTH_TEST, GL_SCISSOR_TEST };
+    if (enabled)
+        glEnable(caps[cap]);
+    else
+        glDisable(caps[cap]);
+}
+
+static inline void GPUStateGL_BlendFunc(uint32 src_rgb, uint32 dst_rgb, uint32 src_alpha, uint32 dst_alpha) {
+    glBlendFuncSeparate(src_rgb, dst_rgb, src_alpha, dst_alpha);
+}
+#endif // MOSS_GPU_STATE_GL
+
+// GL needs MOSS_GPU_STATE_GL (glad), without it GL falls back to the null backend.
+static inline const GPUStateBackend* GetGPUStateBackend(int type) {
+    static const GPUStateBackend null_backend = {
+        "Null", GPUStateNull_UseProgram, GPUStateNull_ActiveTexture, GPUStateNull_BindTexture, GPUStateNull_BindVertexArray,
+        GPUStateNull_SetCapability, GPUStateNull_BlendFunc, GPUStateNull_BlendEquation, GPUStateNull_DepthFunc, GPUStateNull_DepthMask, GPUStateNull_Scissor
+    };
+#ifdef MOSS_GPU_STATE_GL
+    static const GPUStateBackend gl_backend = {
+        "GL", GPUStateGL_UseProgram, GPUStateGL_ActiveTexture, GPUStateGL_BindTexture, GPUStateGL_BindVertexArray,
+        GPUStateGL_SetCapability, GPUStateGL_BlendFunc, GPUStateGL_BlendEquation, GPUStateGL_DepthFunc, GPUStateGL_DepthMask, GPUStateGL_Scissor
+    };
+    if (type == GPU_STATE_BACKEND_GL)
+        return &gl_backend;
+#endif
+    (void)type;
+    return &null_backend;
+}
+
+#endif // GPU_STATE_H
@@ -0,0 +1,787 @@
+//                        MIT License
+//
+//                  Copyright (c) 2024 Toby
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////
+/*                  Input.h
+
+          Input events and the queue between the
+          window thread and the simulation.
+
+          The platform callbacks installed by
+          Moss_setKeyCallbacks() & co. only stamp the
+          event and push it (Input_PushKey(), ...),
+          PollEvents() never runs game code. The
+          simulation drains the queue at the start of
+          its input phase.
+
+          Timestamps are steady clock nanoseconds, so
+          now - Timestamp is the input latency.
+
+          Input is the per frame snapshot: one bit per
+          key, mouse button, gamepad button and
+          gamepad axis direction (INPUT_CODE_*) for
+          down / just pressed / just released. An
+          InputMap action is a mask over the same
+          bits, so an action query is one AND per
+          64 bit word, no lookups.
+
+          int jump = map.add_action("jump");
+          map.action_add_code(jump, INPUT_CODE_KEY(KEY_SPACE));
+          map.action_add_code(jump, INPUT_CODE_GAMEPAD(0, GAMEPAD_BUTTON_A));
+          if (input.is_action_just_pressed(jump)) ...
+
+          InputRecorder / InputReplay store the events
+          each frame consumed in a compact binary file
+          and hand them back frame by frame, replays
+          run on the fixed timestep saved in the file.
+*/
+////////////////////////////////////////////////
+
+#ifndef INPUT_H
+#define INPUT_H
+
+#include "Variants.h"
+#include "Object.h"     // HashStr
+
+#include <atomic>
+#include <chrono>
+#include <stdio.h>      // FILE*
+#include <string.h>     // strcmp
+
+#define INPUT_EVENT_QUEUE_SIZE      1024    // Power of 2. Events pushed while full are dropped and counted.
+
+// InputEvent::Type
+#define INPUT_EVENT_NONE            0
+#define INPUT_EVENT_KEY             1
+#define INPUT_EVENT_MOUSE_BUTTON    2
+#define INPUT_EVENT_MOUSE_MOTION    3
+#define INPUT_EVENT_JOYPAD_MOTION   4
+#define INPUT_EVENT_JOYPAD_BUTTON   5
+
+// Bit index of every digital input, shared by Input and InputMap
+#define INPUT_MAX_GAMEPADS          4
+#define INPUT_AXIS_COUNT            6                                   // GAMEPAD_AXIS_*
+#define INPUT_CODE_KEY(K)           (K)                                 // KEY_*, below 128
+#define INPUT_CODE_MOUSE(B)         (128 + (B))                         // MOUSE_BUTTON_*, MOUSE_WHEEL_*
+#define INPUT_CODE_GAMEPAD(D, B)    (144 + (D) * 16 + (B))              // GAMEPAD_BUTTON_*, JOY_BUTTON_*
+#define INPUT_CODE_AXIS(D, A, POS)  (208 + (D) * 12 + (A) * 2 + (POS))  // Axis past INPUT_AXIS_DEADZONE, POS = 1 for the positive side
+#define INPUT_CODE_COUNT            256
+#define INPUT_BITS_WORDS            (INPUT_CODE_COUNT / 64)
+#define INPUT_AXIS_DEADZONE         0.5f
+
+// Modifier mask
+#define INPUT_MOD_SHIFT             (1 << 0)
+#define INPUT_MOD_CONTROL           (1 << 1)
+#define INPUT_MOD_ALT               (1 << 2)
+#define INPUT_MOD_SUPER             (1 << 3)
+
+// Monotonic, high resolution. The clock every input timestamp is taken from.
+static inline uint64 Input_GetTimeNs() {
+    return (uint64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct InputEventKey
+{
+    int32   Keycode;        // KEY_*
+    int32   Mods;           // INPUT_MOD_*
+    bool    Pressed;
+    bool    Echo;           // Key repeat
+};
+
+struct InputEventMouseButton
+{
+    int32   ButtonIndex;    // MOUSE_BUTTON_*, MOUSE_WHEEL_*
+    int32   Mods;
+    bool    Pressed;
+    bool    DoubleClick;
+    Vector2 Position;
+};
+
+struct InputEventMouseMotion
+{
+    Vector2 Position;
+    Vector2 Relative;
+};
+
+struct InputEventJoypadMotion
+{
+    int32   Device;
+    int32   Axis;           // GAMEPAD_AXIS_*
+    float   AxisValue;      // -1..1, triggers 0..1
+};
+
+struct InputEventJoypadButton
+{
+    int32   Device;
+    int32   ButtonIndex;    // GAMEPAD_BUTTON_*, JOY_BUTTON_*
+    float   Pressure;
+    bool    Pressed;
+};
+
+// Fixed size and trivially copyable so it can travel through the lock free queue.
+struct InputEvent
+{
+    uint64      Timestamp;  // Input_GetTimeNs() when the OS delivered it
+    uint32      Type;       // INPUT_EVENT_*
+    union
+    {
+        uint8                   Raw[20];
+        InputEventKey           Key;
+        InputEventMouseButton   MouseButton;
+        InputEventMouseMotion   MouseMotion;
+        InputEventJoypadMotion  JoypadMotion;
+        InputEventJoypadButton  JoypadButton;
+    };
+
+    InputEvent() : Timestamp(0), Type(INPUT_EVENT_NONE), Raw() {}
+};
+
+static_assert(sizeof(InputEvent) == 32, "InputEvent should stay two per cache line");
+
+struct InputLatencyStats
+{
+    int     EventCount;     // Drained by the last drain()
+    double  AverageMs;      // OS delivery to drain
+    double  MaxMs;
+};
+
+// Bounded multi producer / multi consumer ring (sequence per cell), no locks on either side.
+// Producers are the window thread and joypad polling, the consumer is the simulation.
+class InputEventQueue
+{
+public:
+    InputEventQueue() : Head(0), Tail(0), Dropped(0) {
+        for (uint32 i = 0; i < INPUT_EVENT_QUEUE_SIZE; i++)
+            Cells[i].Sequence.store(i, std::memory_order_relaxed);
+        Latency.EventCount = 0;
+        Latency.AverageMs = 0.0;
+        Latency.MaxMs = 0.0;
+    }
+
+    bool push(const InputEvent& event) {
+        uint32 pos = Tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = Cells[pos & (INPUT_EVENT_QUEUE_SIZE - 1)];
+            const uint32 seq = cell.Sequence.load(std::memory_order_acquire);
+            const int32 diff = (int32)(seq - pos);
+            if (diff == 0) {
+                if (Tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.Event = event;
+                    cell.Sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                // Full, the simulation stalled. Losing input beats blocking the window thread.
+                Dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            } else {
+                pos = Tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool pop(InputEvent& event) {
+        uint32 pos = Head.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = Cells[pos & (INPUT_EVENT_QUEUE_SIZE - 1)];
+            const uint32 seq = cell.Sequence.load(std::memory_order_acquire);
+            const int32 diff = (int32)(seq - (pos + 1));
+            if (diff == 0) {
+                if (Head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    event = cell.Event;
+                    cell.Sequence.store(pos + INPUT_EVENT_QUEUE_SIZE, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = Head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Moves everything queued so far to 'out', oldest first, and measures how long it waited.
+    int drain(TArray<InputEvent>& out) {
+        const uint64 now = Input_GetTimeNs();
+        double total_ms = 0.0, max_ms = 0.0;
+        int count = 0;
+        InputEvent event;
+        while (pop(event)) {
+            const double ms = now > event.Timestamp ? (double)(now - event.Timestamp) * 1e-6 : 0.0;
+            total_ms += ms;
+            max_ms = ms > max_ms ? ms : max_ms;
+            out.push_back(event);
+            count++;
+        }
+        Latency.EventCount = count;
+        Latency.AverageMs = count ? total_ms / count : 0.0;
+        Latency.MaxMs = max_ms;
+        return count;
+    }
+
+    const InputLatencyStats&    get_latency() const         { return Latency; }
+    uint32                      get_dropped_count() const   { return Dropped.load(std::memory_order_relaxed); }
+
+private:
+    struct Cell
+    {
+        std::atomic<uint32> Sequence;
+        InputEvent          Event;
+    };
+
+    Cell                    Cells[INPUT_EVENT_QUEUE_SIZE];
+    alignas(64) std::atomic<uint32> Head;
+    alignas(64) std::atomic<uint32> Tail;
+    alignas(64) std::atomic<uint32> Dropped;
+    InputLatencyStats       Latency;
+};
+
+// The queue the platform callbacks feed
+inline InputEventQueue& GetInputEventQueue() { static InputEventQueue queue; return queue; }
+
+// Called from the platform callbacks, on whatever thread the OS delivers on.
+static inline bool Input_PushKey(int keycode, bool pressed, bool echo, int mods) {
+    InputEvent e;
+    e.Type = INPUT_EVENT_KEY;
+    e.Timestamp = Input_GetTimeNs();
+    e.Key.Keycode = keycode;
+    e.Key.Mods = mods;
+    e.Key.Pressed = pressed;
+    e.Key.Echo = echo;
+    return GetInputEventQueue().push(e);
+}
+
+static inline bool Input_PushMouseButton(int button, bool pressed, bool double_click, int mods, Vector2 position) {
+    InputEvent e;
+    e.Type = INPUT_EVENT_MOUSE_BUTTON;
+    e.Timestamp = Input_GetTimeNs();
+    e.MouseButton.ButtonIndex = button;
+    e.MouseButton.Mods = mods;
+    e.MouseButton.Pressed = pressed;
+    e.MouseButton.DoubleClick = double_click;
+    e.MouseButton.Position = position;
+    return GetInputEventQueue().push(e);
+}
+
+static inline bool Input_PushMouseMotion(Vector2 position, Vector2 relative) {
+    InputEvent e;
+    e.Type = INPUT_EVENT_MOUSE_MOTION;
+    e.Timestamp = Input_GetTimeNs();
+    e.MouseMotion.Position = position;
+    e.MouseMotion.Relative = relative;
+    return GetInputEventQueue().push(e);
+}
+
+static inline bool Input_PushJoypadMotion(int device, int axis, float value) {
+    InputEvent e;
+    e.Type = INPUT_EVENT_JOYPAD_MOTION;
+    e.Timestamp = Input_GetTimeNs();
+    e.JoypadMotion.Device = device;
+    e.JoypadMotion.Axis = axis;
+    e.JoypadMotion.AxisValue = value;
+    return GetInputEventQueue().push(e);
+}
+
+static inline bool Input_PushJoypadButton(int device, int button, bool pressed, float pressure) {
+    InputEvent e;
+    e.Type = INPUT_EVENT_JOYPAD_BUTTON;
+    e.Timestamp = Input_GetTimeNs();
+    e.JoypadButton.Device = device;
+    e.JoypadButton.ButtonIndex = button;
+    e.JoypadButton.Pressed = pressed;
+    e.JoypadButton.Pressure = pressure;
+    return GetInputEventQueue().push(e);
+}
+
+struct InputBits
+{
+    uint64 Words[INPUT_BITS_WORDS];
+
+    InputBits() { clear_all(); }
+
+    void clear_all()            { memset(Words, 0, sizeof(Words)); }
+    void set(int code)          { Words[code >> 6] |= (uint64)1 << (code & 63); }
+    void clear(int code)        { Words[code >> 6] &= ~((uint64)1 << (code & 63)); }
+    bool test(int code) const   { return (Words[code >> 6] >> (code & 63)) & 1; }
+
+    // Branch free, the compiler keeps the four words in registers
+    bool any_of(const InputBits& mask) const {
+        return ((Words[0] & mask.Words[0]) | (Words[1] & mask.Words[1]) | (Words[2] & mask.Words[2]) | (Words[3] & mask.Words[3])) != 0;
+    }
+    bool all_of(const InputBits& mask) const {
+        return ((Words[0] & mask.Words[0]) ^ mask.Words[0]) == 0 && ((Words[1] & mask.Words[1]) ^ mask.Words[1]) == 0
+            && ((Words[2] & mask.Words[2]) ^ mask.Words[2]) == 0 && ((Words[3] & mask.Words[3]) ^ mask.Words[3]) == 0;
+    }
+};
+
+static_assert(INPUT_BITS_WORDS == 4, "InputBits::any_of() is unrolled for 256 codes");
+
+// The INPUT_CODE_* of a digital event, -1 for mouse motion and joypad motion.
+static inline int Input_GetEventCode(const InputEvent& e) {
+    switch (e.Type) {
+    case INPUT_EVENT_KEY:           return e.Key.Keycode >= 0 && e.Key.Keycode < 128 ? INPUT_CODE_KEY(e.Key.Keycode) : -1;
+    case INPUT_EVENT_MOUSE_BUTTON:  return e.MouseButton.ButtonIndex >= 0 && e.MouseButton.ButtonIndex < 16 ? INPUT_CODE_MOUSE(e.MouseButton.ButtonIndex) : -1;
+    case INPUT_EVENT_JOYPAD_BUTTON: return e.JoypadButton.Device >= 0 && e.JoypadButton.Device < INPUT_MAX_GAMEPADS && e.JoypadButton.ButtonIndex >= 0 && e.JoypadButton.ButtonIndex < 16
+                                        ? INPUT_CODE_GAMEPAD(e.JoypadButton.Device, e.JoypadButton.ButtonIndex) : -1;
+    default:                        return -1;
+    }
+}
+
+struct InputAction
+{
+    const char* Name;
+    uint32      NameHash;
+    InputBits   Mask;       // Any of these codes triggers the action
+};
+
+class InputMap
+{
+public:
+    // Returns the existing id when 'name' is already an action. Ids are stable, cache them.
+    int add_action(const char* name) {
+        const int existing = find_action(name);
+        if (existing >= 0)
+            return existing;
+        InputAction action;
+        action.Name = name;
+        action.NameHash = HashStr(name);
+        Actions.push_back(action);
+        return Actions.size() - 1;
+    }
+
+    // The hash skips most actions, the name confirms a match.
+    int find_action(const char* name) const {
+        const uint32 hash = HashStr(name);
+        for (int i = 0; i < Actions.size(); i++)
+            if (Actions[i].NameHash == hash && strcmp(Actions[i].Name, name) == 0)
+                return i;
+        return -1;
+    }
+
+    void action_add_code(int action, int code)      { assert(code >= 0 && code < INPUT_CODE_COUNT); Actions[action].Mask.set(code); }
+    void action_erase_code(int action, int code)    { assert(code >= 0 && code < INPUT_CODE_COUNT); Actions[action].Mask.clear(code); }
+    void action_erase_codes(int action)             { Actions[action].Mask.clear_all(); }
+    bool action_has_code(int action, int code) const { return Actions[action].Mask.test(code); }
+
+    void clear() { Actions.clear(); }
+
+    int                 get_action_count() const        { return Actions.size(); }
+    const InputAction&  get_action(int action) const    { return Actions[action]; }
+    const InputBits&    get_mask(int action) const      { return Actions[action].Mask; }
+
+private:
+    TArray<InputAction> Actions;
+};
+
+// Snapshot of the input for one frame, fed by update() from the event queue.
+struct Input
+{
+    InputBits           Down;
+    InputBits           JustPressed;                // Went down this frame, stays set if it also went up again
+    InputBits           JustReleased;
+    Vector2             MousePosition;
+    Vector2             MouseRelative;              // Summed over the frame
+    float               Axes[INPUT_MAX_GAMEPADS][INPUT_AXIS_COUNT];
+    TArray<InputEvent>  Events;                     // Everything that arrived this frame, in order
+    const InputMap*     Map;
+
+    Input() : Map(nullptr) { memset(Axes, 0, sizeof(Axes)); }
+
+    void begin_frame() {
+        JustPressed.clear_all();
+        JustReleased.clear_all();
+        MouseRelative = Vector2();
+        Events.shrink(0);
+    }
+
+    // Nothing held, mouse and sticks at rest. Recordings and replays start from here.
+    void reset() {
+        begin_frame();
+        Down.clear_all();
+        MousePosition = Vector2();
+        memset(Axes, 0, sizeof(Axes));
+    }
+
+    // Starts a new frame with everything queued since the last one. Returns the event count.
+    int update(InputEventQueue& queue) {
+        begin_frame();
+        queue.drain(Events);
+        for (int i = 0; i < Events.size(); i++)
+            process_event(Events[i]);
+        return Events.size();
+    }
+
+    // Same, from a list instead of the queue (replays).
+    int update(const InputEvent* events, int count) {
+        begin_frame();
+        for (int i = 0; i < count; i++) {
+            Events.push_back(events[i]);
+            process_event(events[i]);
+        }
+        return count;
+    }
+
+    void process_event(const InputEvent& e) {
+        switch (e.Type) {
+        case INPUT_EVENT_KEY:
+            if (!e.Key.Echo)
+                set_code(Input_GetEventCode(e), e.Key.Pressed);
+            break;
+        case INPUT_EVENT_MOUSE_BUTTON:
+            MousePosition = e.MouseButton.Position;
+            set_code(Input_GetEventCode(e), e.MouseButton.Pressed);
+            break;
+        case INPUT_EVENT_MOUSE_MOTION:
+            MousePosition = e.MouseMotion.Position;
+            MouseRelative = MouseRelative + e.MouseMotion.Relative;
+            break;
+        case INPUT_EVENT_JOYPAD_BUTTON:
+            set_code(Input_GetEventCode(e), e.JoypadButton.Pressed);
+            break;
+        case INPUT_EVENT_JOYPAD_MOTION: {
+            const int device = e.JoypadMotion.Device, axis = e.JoypadMotion.Axis;
+            if (device < 0 || device >= INPUT_MAX_GAMEPADS || axis < 0 || axis >= INPUT_AXIS_COUNT)
+                break;
+            const float value = e.JoypadMotion.AxisValue;
+            Axes[device][axis] = value;
+            set_code(INPUT_CODE_AXIS(device, axis, 0), value <= -INPUT_AXIS_DEADZONE);
+            set_code(INPUT_CODE_AXIS(device, axis, 1), value >= INPUT_AXIS_DEADZONE);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    bool is_code_pressed(int code) const        { return Down.test(code); }
+    bool is_key_pressed(int keycode) const      { return Down.test(INPUT_CODE_KEY(keycode)); }
+    bool is_mouse_button_pressed(int b) const   { return Down.test(INPUT_CODE_MOUSE(b)); }
+    bool is_joy_button_pressed(int device, int b) const { return Down.test(INPUT_CODE_GAMEPAD(device, b)); }
+    float get_joy_axis(int device, int axis) const      { return Axes[device][axis]; }
+
+    bool is_action_pressed(int action) const        { return Down.any_of(Map->get_mask(action)); }
+    bool is_action_just_pressed(int action) const   { return JustPressed.any_of(Map->get_mask(action)); }
+    bool is_action_just_released(int action) const { return JustReleased.any_of(Map->get_mask(action)); }
+
+    // By name costs a hash and a search, prefer the id in per frame code
+    bool is_action_pressed(const char* name) const        { const int a = Map->find_action(name); return a >= 0 && is_action_pressed(a); }
+    bool is_action_just_pressed(const char* name) const   { const int a = Map->find_action(name); return a >= 0 && is_action_just_pressed(a); }
+    bool is_action_just_released(const char* name) const  { const int a = Map->find_action(name); return a >= 0 && is_action_just_released(a); }
+
+    // Sub-frame history. Taps shorter than a frame still count, with their own timestamps.
+    int get_press_count(int code) const {
+        int count = 0;
+        for (int i = 0; i < Events.size(); i++)
+            if (Input_GetEventCode(Events[i]) == code && is_press(Events[i]))
+                count++;
+        return count;
+    }
+
+    // Timestamp of the first press of 'code' this frame, 0 if there was none.
+    uint64 get_press_timestamp(int code) const {
+        for (int i = 0; i < Events.size(); i++)
+            if (Input_GetEventCode(Events[i]) == code && is_press(Events[i]))
+                return Events[i].Timestamp;
+        return 0;
+    }
+
+private:
+    void set_code(int code, bool down) {
+        if (code < 0)
+            return;
+        const bool was_down = Down.test(code);
+        if (down && !was_down) {
+            Down.set(code);
+            JustPressed.set(code);
+        } else if (!down && was_down) {
+            Down.clear(code);
+            JustReleased.set(code);
+        }
+    }
+
+    static bool is_press(const InputEvent& e) {
+        return (e.Type == INPUT_EVENT_KEY && e.Key.Pressed && !e.Key.Echo)
+            || (e.Type == INPUT_EVENT_MOUSE_BUTTON && e.MouseButton.Pressed)
+            || (e.Type == INPUT_EVENT_JOYPAD_BUTTON && e.JoypadButton.Pressed);
+    }
+};
+
+/*======================================================================================
+
+    Recording
+
+    "MOSSINPT", uint32 version, uint64 timestep ns, uint32 frame count, then per
+    frame with events: varint frame delta, varint event count, and per event a
+    type byte, varint ns since the frame's first event and the payload. Floats
+    are stored as their bits, little endian, so replays are bit identical.
+
+*/
+#define INPUT_RECORDING_MAGIC       "MOSSINPT"
+#define INPUT_RECORDING_VERSION     1
+#define INPUT_RECORDING_HEADER_SIZE 24
+
+class InputRecorder
+{
+public:
+    InputRecorder() : TimestepNs(0), LastFrame(0), FrameCount(0), Recording(false), Started(false) {}
+
+    // 'timestep_ns' is the fixed step replays run at.
+    void begin(uint64 timestep_ns) {
+        Data.clear();
+        Data.resize(INPUT_RECORDING_HEADER_SIZE, 0);
+        TimestepNs = timestep_ns;
+        FrameCount = 0;
+        Recording = true;
+        Started = false;
+    }
+
+    void end() { Recording = false; }
+    bool is_recording() const { return Recording; }
+
+    // The events one frame consumed. 'frame' only has to increase, frames without events cost nothing.
+    void record_frame(uint64 frame, const InputEvent* events, int count) {
+        if (!Recording)
+            return;
+        // The first frame recorded is frame 0 of the replay
+        if (!Started) {
+            LastFrame = frame;
+            Started = true;
+        }
+        if (count == 0)
+            return;
+        write_varint(frame - LastFrame);
+        write_varint((uint64)count);
+        LastFrame = frame;
+        FrameCount++;
+
+        const uint64 base = events[0].Timestamp;
+        for (int i = 0; i < count; i++) {
+            const InputEvent& e = events[i];
+            write_u8((uint8)e.Type);
+            write_varint(e.Timestamp > base ? e.Timestamp - base : 0);
+            switch (e.Type) {
+            case INPUT_EVENT_KEY:
+                write_varint((uint32)e.Key.Keycode);
+                write_u8((uint8)e.Key.Mods);
+                write_u8((uint8)((e.Key.Pressed ? 1 : 0) | (e.Key.Echo ? 2 : 0)));
+                break;
+            case INPUT_EVENT_MOUSE_BUTTON:
+                write_u8((uint8)e.MouseButton.ButtonIndex);
+                write_u8((uint8)e.MouseButton.Mods);
+                write_u8((uint8)((e.MouseButton.Pressed ? 1 : 0) | (e.MouseButton.DoubleClick ? 2 : 0)));
+                write_float(e.MouseButton.Position.x);
+                write_float(e.MouseButton.Position.y);
+                break;
+            case INPUT_EVENT_MOUSE_MOTION:
+                write_float(e.MouseMotion.Position.x);
+                write_float(e.MouseMotion.Position.y);
+                write_float(e.MouseMotion.Relative.x);
+                write_float(e.MouseMotion.Relative.y);
+                break;
+            case INPUT_EVENT_JOYPAD_MOTION:
+                write_u8((uint8)e.JoypadMotion.Device);
+                write_u8((uint8)e.JoypadMotion.Axis);
+                write_float(e.JoypadMotion.AxisValue);
+                break;
+            case INPUT_EVENT_JOYPAD_BUTTON:
+                write_u8((uint8)e.JoypadButton.Device);
+                write_u8((uint8)e.JoypadButton.ButtonIndex);
+                write_u8(e.JoypadButton.Pressed ? 1 : 0);
+                write_float(e.JoypadButton.Pressure);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    bool save(const char* path) {
+        memcpy(Data.begin(), INPUT_RECORDING_MAGIC, 8);
+        put_u32(Data.begin() + 8, INPUT_RECORDING_VERSION);
+        put_u32(Data.begin() + 12, (uint32)TimestepNs);
+        put_u32(Data.begin() + 16, (uint32)(TimestepNs >> 32));
+        put_u32(Data.begin() + 20, FrameCount);
+        FILE* f = fopen(path, "wb");
+        if (!f)
+            return false;
+        const bool written = fwrite(Data.begin(), 1, Data.size(), f) == (size_t)Data.size();
+        return fclose(f) == 0 && written;
+    }
+
+    int get_size_in_bytes() const { return Data.size(); }
+
+private:
+    static void put_u32(uint8* p, uint32 v) { p[0] = (uint8)v; p[1] = (uint8)(v >> 8); p[2] = (uint8)(v >> 16); p[3] = (uint8)(v >> 24); }
+
+    void write_u8(uint8 v) { Data.push_back(v); }
+    void write_varint(uint64 v) {
+        while (v >= 0x80) {
+            Data.push_back((uint8)(v | 0x80));
+            v >>= 7;
+        }
+        Data.push_back((uint8)v);
+    }
+    void write_float(float v) {
+        uint32 bits;
+        memcpy(&bits, &v, 4);
+        uint8 b[4];
+        put_u32(b, bits);
+        for (int i = 0; i < 4; i++)
+            Data.push_back(b[i]);
+    }
+
+    TArray<uint8>   Data;
+    uint64          TimestepNs;
+    uint64          LastFrame;
+    uint32          FrameCount;
+    bool            Recording;
+    bool            Started;
+};
+
+class InputReplay
+{
+public:
+    InputReplay() : TimestepNs(0), FrameCount(0), FramesRead(0), Cursor(0), NextFrame(0) {}
+
+    bool load(const char* path) {
+        Data.clear();
+        FILE* f = fopen(path, "rb");
+        if (!f)
+            return false;
+        fseek(f, 0, SEEK_END);
+        const long size = ftell(f);
+        fseek(f, 0, SEEK_SET);
+        if (size < INPUT_RECORDING_HEADER_SIZE) {
+            fclose(f);
+            return false;
+        }
+        Data.resize((int)size);
+        const bool read = fread(Data.begin(), 1, (size_t)size, f) == (size_t)size;
+        fclose(f);
+        if (!read || memcmp(Data.begin(), INPUT_RECORDING_MAGIC, 8) != 0 || get_u32(8) != INPUT_RECORDING_VERSION) {
+            Data.clear();
+            return false;
+        }
+        TimestepNs = (uint64)get_u32(12) | ((uint64)get_u32(16) << 32);
+        FrameCount = get_u32(20);
+        rewind();
+        return true;
+    }
+
+    void rewind() {
+        Cursor = INPUT_RECORDING_HEADER_SIZE;
+        FramesRead = 0;
+        NextFrame = 0;
+        if (FrameCount)
+            NextFrame = read_varint();
+    }
+
+    // Appends the events of 'frame' (counted from the start of the replay) to 'out', returns how many.
+    // Frames must be asked for in increasing order.
+    int read_frame(uint64 frame, TArray<InputEvent>& out) {
+        if (is_finished() || frame != NextFrame)
+            return 0;
+        const int count = (int)read_varint();
+        const uint64 base = frame * TimestepNs;
+        for (int i = 0; i < count; i++) {
+            InputEvent e;
+            e.Type = read_u8();
+            e.Timestamp = base + read_varint();
+            switch (e.Type) {
+            case INPUT_EVENT_KEY:
+                e.Key.Keycode = (int32)read_varint();
+                e.Key.Mods = read_u8();
+                { const uint8 flags = read_u8(); e.Key.Pressed = (flags & 1) != 0; e.Key.Echo = (flags & 2) != 0; }
+                break;
+            case INPUT_EVENT_MOUSE_BUTTON:
+                e.MouseButton.ButtonIndex = read_u8();
+                e.MouseButton.Mods = read_u8();
+                { const uint8 flags = read_u8(); e.MouseButton.Pressed = (flags & 1) != 0; e.MouseButton.DoubleClick = (flags & 2) != 0; }
+                e.MouseButton.Position.x = read_float();
+                e.MouseButton.Position.y = read_float();
+                break;
+            case INPUT_EVENT_MOUSE_MOTION:
+                e.MouseMotion.Position.x = read_float();
+                e.MouseMotion.Position.y = read_float();
+                e.MouseMotion.Relative.x = read_float();
+                e.MouseMotion.Relative.y = read_float();
+                break;
+            case INPUT_EVENT_JOYPAD_MOTION:
+                e.JoypadMotion.Device = read_u8();
+                e.JoypadMotion.Axis = read_u8();
+                e.JoypadMotion.AxisValue = read_float();
+                break;
+            case INPUT_EVENT_JOYPAD_BUTTON:
+                e.JoypadButton.Device = read_u8();
+                e.JoypadButton.ButtonIndex = read_u8();
+                e.JoypadButton.Pressed = read_u8() != 0;
+                e.JoypadButton.Pressure = read_float();
+                break;
+            default:
+                break;
+            }
+            out.push_back(e);
+        }
+        if (++FramesRead < FrameCount)
+            NextFrame += read_varint();
+        return count;
+    }
+
+    bool    is_finished() const         { return FramesRead >= FrameCount || Cursor >= Data.size(); }
+    uint64  get_timestep_ns() const     { return TimestepNs; }
+    uint32  get_frame_count() const     { return FrameCount; }
+    uint64  get_last_frame() const      { return NextFrame; }
+
+private:
+    uint32 get_u32(int at) const { return (uint32)Data[at] | ((uint32)Data[at + 1] << 8) | ((uint32)Data[at + 2] << 16) | ((uint32)Data[at + 3] << 24); }
+
+    // Truncated files read as zeros instead of running off the end
+    uint8 read_u8() { return Cursor < Data.size() ? Data[Cursor++] : 0; }
+    uint64 read_varint() {
+        uint64 v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            const uint8 b = read_u8();
+            v |= (uint64)(b & 0x7F) << shift;
+            if (!(b & 0x80))
+                break;
+        }
+        return v;
+    }
+    float read_float() {
+        uint32 bits = 0;
+        for (int i = 0; i < 4; i++)
+            bits |= (uint32)read_u8() << (i * 8);
+        float v;
+        memcpy(&v, &bits, 4);
+        return v;
+    }
+
+    TArray<uint8>   Data;
+    uint64          TimestepNs;
+    uint32          FrameCount;
+    uint32          FramesRead;
+    int             Cursor;
+    uint64          NextFrame;
+};
+
+#endif // INPUT_H
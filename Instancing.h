@@ -0,0 +1,376 @@
+//                        MIT License
+//
+//                  Copyright (c) 2024 Toby
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////
+/*                  Instancing.h
+
+          Draws many copies of one mesh with one call.
+          Thousands of trees or bullets are separate
+          Sprite2D / MeshInstance nodes, drawn one by
+          one they cost a draw call each.
+
+          Nodes add their transform and color, the batch
+          groups them by mesh and material, packs each
+          group contiguously into a StreamBuffer and
+          emits one InstanceDrawCmd per group.
+
+          batch.begin();
+          batch.add_sprite(quad, material, position, rotation, scale, col);
+          batch.add_mesh(tree, bark, position, x_axis, y_axis, z_axis, col);
+          batch.end(instances);          // StreamBuffer
+          for (const InstanceDrawCmd& cmd : batch.get_commands()) ...
+
+          get_stats() has the per node draw count next
+          to the instanced one, for Engine::add_draw_calls().
+
+          Packed per instance data:
+          Sprite  20 bytes  float2 position, half 2x2
+                            rotation * scale, RGBA8
+          Mesh    36 bytes  float3 position, RGBA8,
+                            half 3x3 basis
+          against 40 / 80 bytes as floats. Positions stay
+          float: half has 1 unit steps at 2048, too
+          coarse for world coordinates. The basis is
+          relative to the mesh, half is plenty there.
+*/
+////////////////////////////////////////////////
+
+#ifndef INSTANCING_H
+#define INSTANCING_H
+
+#include "Variants.h"
+#include "StreamBuffer.h"
+
+#include <stddef.h>     // offsetof
+#include <string.h>     // memcpy
+
+#define INSTANCE_FORMAT_SPRITE      0
+#define INSTANCE_FORMAT_MESH        1
+#define INSTANCE_FORMAT_COUNT       2
+
+#define INSTANCE_NO_OFFSET          0xFFFFFFFFu     // Group whose instances didn't fit the stream buffer
+
+// IEEE half, round to nearest even. Overflow goes to infinity, NaN stays NaN.
+static inline uint16 FloatToHalf(float value) {
+    uint32 bits;
+    memcpy(&bits, &value, 4);
+    const uint32 sign = (bits >> 16) & 0x8000u;
+    uint32 abs = bits & 0x7FFFFFFFu;
+    uint32 half;
+    if (abs >= 0x47800000u) {
+        half = abs > 0x7F800000u ? 0x7E00u : 0x7C00u;
+    }
+    else if (abs < 0x38800000u) {
+        // Subnormal: adding 0.5 lines the mantissa up so the FPU does the rounding
+        float f;
+        memcpy(&f, &abs, 4);
+        f += 0.5f;
+        memcpy(&half, &f, 4);
+        half -= 0x3F000000u;
+    }
+    else {
+        const uint32 odd = (abs >> 13) & 1u;
+        abs += ((uint32)(15 - 127) << 23) + 0xFFFu + odd;
+        half = abs >> 13;
+    }
+    return (uint16)(sign | half);
+}
+
+static inline float HalfToFloat(uint16 half) {
+    const uint32 exp_mask = 0x7C00u << 13;
+    uint32 bits = ((uint32)half & 0x7FFFu) << 13;
+    const uint32 exp = bits & exp_mask;
+    bits += (uint32)(127 - 15) << 23;
+    if (exp == exp_mask) {
+        bits += (uint32)(128 - 16) << 23;
+    }
+    else if (exp == 0) {
+        bits += 1u << 23;
+        float f;
+        memcpy(&f, &bits, 4);
+        f -= 6.103515625e-05f;     // 2^-14
+        memcpy(&bits, &f, 4);
+    }
+    bits |= ((uint32)half & 0x8000u) << 16;
+    float result;
+    memcpy(&result, &bits, 4);
+    return result;
+}
+
+struct InstanceSprite
+{
+    float       Position[2];
+    uint16      Basis[4];       // Half: x axis, y axis
+    uint32      Col;            // RGBA8, DRAW_COL32()
+};
+
+struct InstanceMesh
+{
+    float       Position[3];
+    uint32      Col;
+    uint16      Basis[9];       // Half: x, y, z axis
+    uint16      Pad;
+};
+
+static_assert(sizeof(InstanceSprite) == 20, "InstanceSprite is uploaded as is");
+static_assert(sizeof(InstanceMesh) == 36, "InstanceMesh is uploaded as is");
+
+static inline uint32 InstanceFormat_Stride(int format) { return format == INSTANCE_FORMAT_SPRITE ? (uint32)sizeof(InstanceSprite) : (uint32)sizeof(InstanceMesh); }
+
+// One instanced draw: InstanceCount copies of Mesh, per instance data at Offset in the stream buffer.
+struct InstanceDrawCmd
+{
+    uint32      Mesh;
+    uint32      Material;
+    int         Format;
+    uint32      Offset;         // Bytes, a multiple of the format's stride
+    uint32      InstanceCount;
+};
+
+struct InstanceBatchStats
+{
+    int         Instances;
+    int         DrawCalls;
+    int         DrawCallsUnbatched;     // One per instance, what drawing the nodes one by one costs
+    uint32      Bytes;                  // Instance data written this frame
+    int         DroppedInstances;       // The stream buffer was full
+};
+
+class InstanceBatch
+{
+public:
+    InstanceBatch() : LastKey(~0ull), LastGroup(-1) {
+        memset(&Stats, 0, sizeof(Stats));
+        begin();
+    }
+
+    // Groups are kept across frames, only their counts restart.
+    void begin() {
+        for (int i = 0; i < Groups.size(); i++)
+            Groups[i].Count = 0;
+        Sprites.shrink(0);
+        Meshes.shrink(0);
+        for (int f = 0; f < INSTANCE_FORMAT_COUNT; f++) {
+            GroupOf[f].shrink(0);
+            Runs[f] = 0;
+            RunGroup[f] = -1;
+        }
+        Commands.shrink(0);
+    }
+
+    // 'scale' is the sprite size in mesh units, rotation in radians.
+    void add_sprite(uint32 mesh, uint32 material, const Vector2& position, float rotation, const Vector2& scale, uint32 col) {
+        GroupOf[INSTANCE_FORMAT_SPRITE].push_back((uint32)find_group(mesh, material, INSTANCE_FORMAT_SPRITE));
+        const float c = Cos(rotation), s = Sin(rotation);
+        InstanceSprite instance;
+        instance.Position[0] = position.x;
+        instance.Position[1] = position.y;
+        instance.Basis[0] = FloatToHalf(c * scale.x);
+        instance.Basis[1] = FloatToHalf(s * scale.x);
+        instance.Basis[2] = FloatToHalf(-s * scale.y);
+        instance.Basis[3] = FloatToHalf(c * scale.y);
+        instance.Col = col;
+        Sprites.push_back(instance);
+    }
+
+    // The axes carry rotation and scale.
+    void add_mesh(uint32 mesh, uint32 material, const Vector3& position, const Vector3& x_axis, const Vector3& y_axis, const Vector3& z_axis, uint32 col) {
+        GroupOf[INSTANCE_FORMAT_MESH].push_back((uint32)find_group(mesh, material, INSTANCE_FORMAT_MESH));
+        InstanceMesh instance;
+        instance.Position[0] = position.x;
+        instance.Position[1] = position.y;
+        instance.Position[2] = position.z;
+        instance.Col = col;
+        instance.Basis[0] = FloatToHalf(x_axis.x); instance.Basis[1] = FloatToHalf(x_axis.y); instance.Basis[2] = FloatToHalf(x_axis.z);
+        instance.Basis[3] = FloatToHalf(y_axis.x); instance.Basis[4] = FloatToHalf(y_axis.y); instance.Basis[5] = FloatToHalf(y_axis.z);
+        instance.Basis[6] = FloatToHalf(z_axis.x); instance.Basis[7] = FloatToHalf(z_axis.y); instance.Basis[8] = FloatToHalf(z_axis.z);
+        instance.Pad = 0;
+        Meshes.push_back(instance);
+    }
+
+    // Writes every group contiguously into 'stream' and builds the commands, in the order groups were first seen.
+    // False if the stream buffer couldn't take a format's instances, those are dropped.
+    bool end(StreamBuffer& stream) {
+        Stats.Instances = Sprites.size() + Meshes.size();
+        Stats.DrawCallsUnbatched = Stats.Instances;
+        Stats.Bytes = 0;
+        Stats.DroppedInstances = 0;
+        const bool sprites = write(stream, INSTANCE_FORMAT_SPRITE, Sprites.begin(), Sprites.size());
+        const bool meshes = write(stream, INSTANCE_FORMAT_MESH, Meshes.begin(), Meshes.size());
+
+        for (int i = 0; i < Groups.size(); i++) {
+            const InstanceGroup& group = Groups[i];
+            if (!group.Count || group.Offset == INSTANCE_NO_OFFSET)
+                continue;
+            InstanceDrawCmd cmd;
+            cmd.Mesh = group.Mesh;
+            cmd.Material = group.Material;
+            cmd.Format = group.Format;
+            cmd.Offset = group.Offset;
+            cmd.InstanceCount = group.Count;
+            Commands.push_back(cmd);
+        }
+        Stats.DrawCalls = Commands.size();
+        return sprites && meshes;
+    }
+
+    const TArray<InstanceDrawCmd>&  get_commands() const    { return Commands; }
+    const InstanceBatchStats&       get_stats() const       { return Stats; }
+
+    // Forget the mesh/material pairs, for a level change.
+    void clear_groups() {
+        Groups.clear();
+        GroupMap = TMap<uint64, int>();
+        LastKey = ~0ull;
+        LastGroup = -1;
+    }
+
+private:
+    struct InstanceGroup
+    {
+        uint32  Mesh;
+        uint32  Material;
+        int     Format;
+        uint32  Count;
+        uint32  First;      // Index of the first instance this frame, in add order
+        uint32  Offset;     // Set by end()
+    };
+
+    // Nodes of one kind usually come in a row, the last group answers most lookups.
+    int find_group(uint32 mesh, uint32 material, int format) {
+        const uint64 key = ((uint64)mesh << 32) | material;
+        int group = LastGroup;
+        if (key != LastKey && !GroupMap.get(key, group)) {
+            group = Groups.size();
+            InstanceGroup g;
+            g.Mesh = mesh;
+            g.Material = material;
+            g.Format = format;
+            g.Count = 0;
+            g.First = 0;
+            g.Offset = INSTANCE_NO_OFFSET;
+            Groups.push_back(g);
+            GroupMap.add(key, group);
+        }
+        assert(Groups[group].Format == format && "A mesh/material pair is either sprites or meshes");
+        LastKey = key;
+        LastGroup = group;
+        if (RunGroup[format] != group) {
+            RunGroup[format] = group;
+            Runs[format]++;
+        }
+        if (!Groups[group].Count)
+            Groups[group].First = (uint32)GroupOf[format].size();
+        Groups[group].Count++;
+        return group;
+    }
+
+    // Counting sort by group straight into the mapped buffer, each group's range is written front to back.
+    // When every group came in one run the instances are already grouped: one copy, groups stay where they are.
+    template<typename T>
+    bool write(StreamBuffer& stream, int format, const T* instances, int count) {
+        if (!count)
+            return true;
+        uint32 offset = 0;
+        T* dst = stream.alloc<T>(count, &offset);
+        if (!dst) {
+            for (int i = 0; i < Groups.size(); i++)
+                if (Groups[i].Format == format)
+                    Groups[i].Offset = INSTANCE_NO_OFFSET;
+            Stats.DroppedInstances += count;
+            return false;
+        }
+
+        int groups = 0;
+        for (int i = 0; i < Groups.size(); i++)
+            groups += Groups[i].Format == format && Groups[i].Count ? 1 : 0;
+        Stats.Bytes += (uint32)(count * sizeof(T));
+        if (groups == Runs[format]) {
+            for (int i = 0; i < Groups.size(); i++)
+                if (Groups[i].Format == format)
+                    Groups[i].Offset = offset + Groups[i].First * (uint32)sizeof(T);
+            memcpy(dst, instances, count * sizeof(T));
+            return true;
+        }
+
+        Cursors.resize_uninitialized(Groups.size());
+        uint32 first = 0;
+        for (int i = 0; i < Groups.size(); i++) {
+            if (Groups[i].Format != format)
+                continue;
+            Groups[i].Offset = offset + first * (uint32)sizeof(T);
+            Cursors[i] = first;
+            first += Groups[i].Count;
+        }
+
+        const uint32* group_of = GroupOf[format].begin();
+        for (int i = 0; i < count; i++)
+            memcpy(dst + Cursors[(int)group_of[i]]++, instances + i, sizeof(T));
+        return true;
+    }
+
+    TArray<InstanceGroup>       Groups;
+    TMap<uint64, int>           GroupMap;
+    uint64                      LastKey;
+    int                         LastGroup;
+    TArray<InstanceSprite>      Sprites;
+    TArray<InstanceMesh>        Meshes;
+    TArray<uint32>              GroupOf[INSTANCE_FORMAT_COUNT];     // Group of each instance, in add order
+    int                         Runs[INSTANCE_FORMAT_COUNT];        // Group changes in add order
+    int                         RunGroup[INSTANCE_FORMAT_COUNT];
+    TArray<uint32>              Cursors;
+    TArray<InstanceDrawCmd>     Commands;
+    InstanceBatchStats          Stats;
+};
+
+#ifdef MOSS_INSTANCING_GL
+#include "thirdparty/glad/glad.h"
+
+// Points attributes 'location'.. at the instances of 'cmd' in the bound GL_ARRAY_BUFFER, one step per instance.
+// Sprite: 3 attributes (position, basis, color). Mesh: 5 (position, color, basis rows). Returns the count.
+static inline int InstanceGL_SetAttributes(const InstanceDrawCmd& cmd, GLuint location) {
+    const GLsizei stride = (GLsizei)InstanceFormat_Stride(cmd.Format);
+    const char* base = (const char*)(size_t)cmd.Offset;
+    int count;
+    if (cmd.Format == INSTANCE_FORMAT_SPRITE) {
+        glVertexAttribPointer(location + 0, 2, GL_FLOAT, GL_FALSE, stride, base + offsetof(InstanceSprite, Position));
+        glVertexAttribPointer(location + 1, 4, GL_HALF_FLOAT, GL_FALSE, stride, base + offsetof(InstanceSprite, Basis));
+        glVertexAttribPointer(location + 2, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, base + offsetof(InstanceSprite, Col));
+        count = 3;
+    }
+    else {
+        glVertexAttribPointer(location + 0, 3, GL_FLOAT, GL_FALSE, stride, base + offsetof(InstanceMesh, Position));
+        glVertexAttribPointer(location + 1, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, base + offsetof(InstanceMesh, Col));
+        for (int row = 0; row < 3; row++)
+            glVertexAttribPointer(location + 2 + row, 3, GL_HALF_FLOAT, GL_FALSE, stride, base + offsetof(InstanceMesh, Basis) + row * 3 * sizeof(uint16));
+        count = 5;
+    }
+    for (int i = 0; i < count; i++) {
+        glEnableVertexAttribArray(location + i);
+        glVertexAttribDivisor(location + i, 1);
+    }
+    return count;
+}
+#endif // MOSS_INSTANCING_GL
+
+#endif // INSTANCING_H
@@ -0,0 +1,417 @@
+//                        MIT License
+//
+//                  Copyright (c) 2024 Toby
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////
+/*                  Jobs.h
+
+          Engine-wide job system. One per engine,
+          shared by physics, particles, animation,
+          culling, ... instead of each spinning its
+          own threads.
+
+          - One work-stealing deque per thread
+          - JobCounter for dependencies and waiting
+          - parallel_for over index ranges / TArray
+          - Main thread jobs (OpenGL calls), run by
+            run_main_thread_jobs() or while the main
+            thread waits
+
+          The main thread is worker 0, waiting on a
+          counter executes other jobs instead of blocking.
+*/
+////////////////////////////////////////////////
+
+#ifndef JOBS_H
+#define JOBS_H
+
+#include "Variants.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#define JOB_MAX_THREADS     64
+#define JOB_DEQUE_SIZE      4096    // Per thread, power of 2
+#define JOB_POOL_SIZE       4096    // Per thread ring of Job storage, jobs past it in flight go to the heap
+
+#define JOB_AFFINITY_ANY    0
+#define JOB_AFFINITY_MAIN   1       // Only ever run on the main thread (GL context owner)
+
+typedef void (*JobFunc)(void* data);
+
+struct Job;
+
+// Counts unfinished jobs. Jobs added with a 'wait_for' counter are queued when it reaches zero.
+struct JobCounter
+{
+    std::atomic<int32>  Value;
+    std::atomic<int32>  Finishing;      // Workers still using the counter after their decrement
+    std::mutex          Mutex;
+    TArray<Job*>        Continuations;
+
+    JobCounter() : Value(0), Finishing(0) {}
+    // Done once nothing touches the counter anymore, a waiter may then destroy it.
+    bool is_done() const { return Value.load(std::memory_order_acquire) == 0 && Finishing.load(std::memory_order_acquire) == 0; }
+};
+
+struct Job
+{
+    JobFunc         Func;
+    void*           Data;
+    JobCounter*     Counter;    // Decremented when the job finishes, may be null
+    int             Affinity;
+    bool            Heap;       // Allocated by a non worker thread, or the pool slot was still live
+    std::atomic<bool> InUse;    // Pool slot taken, cleared once the job has run
+
+    Job() : Func(nullptr), Data(nullptr), Counter(nullptr), Affinity(JOB_AFFINITY_ANY), Heap(false), InUse(false) {}
+};
+
+// Chase-Lev deque. push/pop from the owning thread only, steal from any thread.
+struct JobDeque
+{
+    std::atomic<int64>  Top;
+    std::atomic<int64>  Bottom;
+    std::atomic<Job*>   Entries[JOB_DEQUE_SIZE];
+
+    JobDeque() : Top(0), Bottom(0) {}
+
+    bool push(Job* job) {
+        const int64 b = Bottom.load(std::memory_order_relaxed);
+        const int64 t = Top.load(std::memory_order_acquire);
+        if (b - t >= JOB_DEQUE_SIZE)
+            return false;
+        Entries[b & (JOB_DEQUE_SIZE - 1)].store(job, std::memory_order_relaxed);
+        Bottom.store(b + 1, std::memory_order_release);
+        return true;
+    }
+
+    Job* pop() {
+        const int64 b = Bottom.load(std::memory_order_relaxed) - 1;
+        Bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64 t = Top.load(std::memory_order_relaxed);
+        if (t > b) {
+            Bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        Job* job = Entries[b & (JOB_DEQUE_SIZE - 1)].load(std::memory_order_relaxed);
+        if (t == b) {
+            // Last job, race against thieves
+            if (!Top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                job = nullptr;
+            Bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return job;
+    }
+
+    Job* steal() {
+        int64 t = Top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64 b = Bottom.load(std::memory_order_acquire);
+        if (t >= b)
+            return nullptr;
+        Job* job = Entries[t & (JOB_DEQUE_SIZE - 1)].load(std::memory_order_relaxed);
+        if (!Top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return nullptr;
+        return job;
+    }
+};
+
+class JobSystem
+{
+public:
+    JobSystem() : ThreadCount(0), Running(false), Pending(0) {}
+    ~JobSystem() { shutdown(); }
+
+    // 'thread_count' includes the main thread, 0 = one per hardware thread.
+    void init(int thread_count = 0) {
+        if (thread_count <= 0)
+            thread_count = (int)std::thread::hardware_concurrency();
+        ThreadCount = Clamp(thread_count, 1, JOB_MAX_THREADS);
+        Running.store(true);
+        tls_worker_index() = 0;
+        for (int i = 0; i < ThreadCount; i++)
+            Workers[i] = new WorkerData();
+        for (int i = 1; i < ThreadCount; i++)
+            Workers[i]->Thread = std::thread(&JobSystem::worker_main, this, i);
+    }
+
+    void shutdown() {
+        if (!Running.exchange(false))
+            return;
+        {
+            std::lock_guard<std::mutex> lock(SleepMutex);
+            SleepCond.notify_all();
+        }
+        for (int i = 1; i < ThreadCount; i++)
+            Workers[i]->Thread.join();
+        for (int i = 0; i < ThreadCount; i++)
+            delete Workers[i];
+        SharedJobs.clear();
+        MainThreadJobs.clear();
+        ThreadCount = 0;
+    }
+
+    int get_thread_count() const { return ThreadCount; }
+
+    // Worker index of the calling thread, 0 for the main thread, -1 for threads not owned by the job system.
+    static int get_worker_index() { return tls_worker_index(); }
+
+    void submit(JobFunc func, void* data, JobCounter* counter = nullptr, int affinity = JOB_AFFINITY_ANY) {
+        Job* job = allocate_job(func, data, counter, affinity);
+        if (counter)
+            counter->Value.fetch_add(1, std::memory_order_relaxed);
+        enqueue(job);
+    }
+
+    // Runs once 'wait_for' reaches zero (immediately if it already is).
+    void submit_after(JobCounter* wait_for, JobFunc func, void* data, JobCounter* counter = nullptr, int affinity = JOB_AFFINITY_ANY) {
+        Job* job = allocate_job(func, data, counter, affinity);
+        if (counter)
+            counter->Value.fetch_add(1, std::memory_order_relaxed);
+        {
+            // Value only, not is_done(): once it is zero release_continuations() may already
+            // have swapped the list out while the last worker is still finishing.
+            std::lock_guard<std::mutex> lock(wait_for->Mutex);
+            if (wait_for->Value.load(std::memory_order_acquire) != 0) {
+                wait_for->Continuations.push_back(job);
+                return;
+            }
+        }
+        enqueue(job);
+    }
+
+    // Executes other jobs until 'counter' reaches zero.
+    void wait(JobCounter* counter) {
+        const int index = tls_worker_index();
+        while (!counter->is_done()) {
+            if (index == 0 && run_one_main_thread_job())
+                continue;
+            Job* job = index >= 0 ? find_job(index) : nullptr;
+            if (job)
+                execute(job);
+            else
+                std::this_thread::yield();
+        }
+    }
+
+    // Call from the main thread once per frame (or rely on wait()).
+    void run_main_thread_jobs() {
+        assert(tls_worker_index() == 0);
+        while (run_one_main_thread_job()) {}
+    }
+
+    // func(int start, int end) on [begin, end) split in 'grain' sized chunks. Blocks until done.
+    template<typename F>
+    void parallel_for(int begin, int end, int grain, const F& func) {
+        if (end <= begin)
+            return;
+        // Also covers a job system that isn't init() yet
+        if (ThreadCount <= 1) {
+            func(begin, end);
+            return;
+        }
+        if (grain <= 0)
+            grain = Max(1, (end - begin) / (ThreadCount * 4));
+        const int chunk_count = (end - begin + grain - 1) / grain;
+        if (chunk_count == 1) {
+            func(begin, end);
+            return;
+        }
+
+        TArray<ParallelForRange<F> > ranges;
+        ranges.resize(chunk_count);
+        JobCounter counter;
+        for (int i = 0; i < chunk_count; i++) {
+            ranges[i].Func = &func;
+            ranges[i].Start = begin + i * grain;
+            ranges[i].End = Min(ranges[i].Start + grain, end);
+            // Keep the first chunk for the calling thread
+            if (i > 0)
+                submit(&ParallelForRange<F>::run, &ranges[i], &counter);
+        }
+        func(ranges[0].Start, ranges[0].End);
+        wait(&counter);
+    }
+
+    // func(T& item, int index) for every element.
+    template<typename T, typename F>
+    void parallel_for(TArray<T>& array, int grain, const F& func) {
+        T* data = array.begin();
+        parallel_for(0, array.size(), grain, [data, &func](int start, int end) {
+            for (int i = start; i < end; i++)
+                func(data[i], i);
+        });
+    }
+
+private:
+    template<typename F>
+    struct ParallelForRange
+    {
+        const F*    Func;
+        int         Start;
+        int         End;
+        static void run(void* data) { ParallelForRange* r = (ParallelForRange*)data; (*r->Func)(r->Start, r->End); }
+    };
+
+    struct WorkerData
+    {
+        JobDeque        Deque;
+        Job             Pool[JOB_POOL_SIZE];
+        uint32          PoolIndex = 0;
+        uint32          StealSeed = 0;
+        std::thread     Thread;
+    };
+
+    static int& tls_worker_index() { static thread_local int index = -1; return index; }
+
+    Job* allocate_job(JobFunc func, void* data, JobCounter* counter, int affinity) {
+        const int index = tls_worker_index();
+        Job* job = nullptr;
+        if (index >= 0) {
+            // Only the owner takes slots, any thread gives them back
+            WorkerData* w = Workers[index];
+            Job* slot = &w->Pool[w->PoolIndex++ & (JOB_POOL_SIZE - 1)];
+            if (!slot->InUse.load(std::memory_order_acquire)) {
+                slot->InUse.store(true, std::memory_order_relaxed);
+                slot->Heap = false;
+                job = slot;
+            }
+        }
+        if (!job) {
+            job = new Job();
+            job->Heap = true;
+        }
+        job->Func = func;
+        job->Data = data;
+        job->Counter = counter;
+        job->Affinity = affinity;
+        return job;
+    }
+
+    void enqueue(Job* job) {
+        // Read before publishing, once queued another thread may run and free the job
+        const bool main_thread = job->Affinity == JOB_AFFINITY_MAIN;
+        const int index = tls_worker_index();
+        if (main_thread || index < 0 || !Workers[index]->Deque.push(job)) {
+            std::lock_guard<std::mutex> lock(SharedMutex);
+            if (main_thread)
+                MainThreadJobs.push_back(job);
+            else
+                SharedJobs.push_back(job);
+        }
+        if (!main_thread) {
+            Pending.fetch_add(1, std::memory_order_release);
+            SleepCond.notify_one();
+        }
+    }
+
+    Job* find_job(int index) {
+        Job* job = Workers[index]->Deque.pop();
+        if (job)
+            return job;
+
+        // Steal, starting at a pseudo random victim so thieves spread out
+        WorkerData* self = Workers[index];
+        self->StealSeed = self->StealSeed * 1664525u + 1013904223u;
+        const int start = (int)(self->StealSeed >> 16) % ThreadCount;
+        for (int i = 0; i < ThreadCount; i++) {
+            const int victim = (start + i) % ThreadCount;
+            if (victim != index && (job = Workers[victim]->Deque.steal()) != nullptr)
+                return job;
+        }
+
+        std::lock_guard<std::mutex> lock(SharedMutex);
+        if (SharedJobs.empty())
+            return nullptr;
+        job = SharedJobs.back();
+        SharedJobs.pop_back();
+        return job;
+    }
+
+    bool run_one_main_thread_job() {
+        Job* job;
+        {
+            std::lock_guard<std::mutex> lock(SharedMutex);
+            if (MainThreadJobs.empty())
+                return false;
+            job = MainThreadJobs.front();
+            MainThreadJobs.erase(MainThreadJobs.begin());
+        }
+        execute(job);
+        return true;
+    }
+
+    void execute(Job* job) {
+        if (job->Affinity != JOB_AFFINITY_MAIN)
+            Pending.fetch_sub(1, std::memory_order_relaxed);
+        job->Func(job->Data);
+        JobCounter* counter = job->Counter;
+        if (job->Heap)
+            delete job;
+        else
+            job->InUse.store(false, std::memory_order_release);
+        if (counter) {
+            counter->Finishing.fetch_add(1, std::memory_order_relaxed);
+            if (counter->Value.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                release_continuations(counter);
+            counter->Finishing.fetch_sub(1, std::memory_order_release);
+        }
+    }
+
+    void release_continuations(JobCounter* counter) {
+        TArray<Job*> ready;
+        {
+            std::lock_guard<std::mutex> lock(counter->Mutex);
+            ready.swap(counter->Continuations);
+        }
+        for (int i = 0; i < ready.size(); i++)
+            enqueue(ready[i]);
+    }
+
+    void worker_main(int index) {
+        tls_worker_index() = index;
+        while (Running.load(std::memory_order_acquire)) {
+            Job* job = find_job(index);
+            if (job) {
+                execute(job);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(SleepMutex);
+            SleepCond.wait_for(lock, std::chrono::milliseconds(1), [this] { return Pending.load(std::memory_order_acquire) > 0 || !Running.load(); });
+        }
+    }
+
+    int                         ThreadCount;
+    WorkerData*                 Workers[JOB_MAX_THREADS];
+    std::atomic<bool>           Running;
+    std::atomic<int32>          Pending;            // Queued worker jobs, not yet started
+    std::mutex                  SharedMutex;        // Guards the two queues below
+    TArray<Job*>                SharedJobs;         // From non worker threads, or when a deque is full
+    TArray<Job*>                MainThreadJobs;     // JOB_AFFINITY_MAIN, FIFO
+    std::mutex                  SleepMutex;
+    std::condition_variable     SleepCond;
+};
+
+#endif // JOBS_H
@@ -0,0 +1,590 @@
+//                        MIT License
+//
+//                  Copyright (c) 2024 Toby
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////
+/*                  Memory.h
+
+          Allocators.
+
+          MemoryTracker   - live bytes, high-water mark and
+                            per frame allocation rate for
+                            each MEMORY_TAG_*, leak report
+                            on shutdown
+          Memory_Alloc    - tagged malloc/free
+          TaggedHeap<TAG> - TArray policy allocating under TAG
+          HeapAllocator   - TaggedHeap<MEMORY_TAG_GENERAL>, default for TArray
+          FrameAllocator  - per thread linear arenas that
+                            live for FRAME_ALLOCATOR_BUFFER_COUNT
+                            frames, reset in O(1)
+          FrameHeap       - TArray policy allocating from
+                            the frame allocator
+
+          FrameArray<InputEvent> events;   // Gone after the render thread used it
+          TArray<Body, TaggedHeap<MEMORY_TAG_PHYSICS>> bodies;
+
+          Define MOSS_MEMORY_TRACKING 0 to compile the
+          tracking out. Left on it costs a 16 byte header
+          and one shared atomic add per allocation.
+*/
+////////////////////////////////////////////////
+
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <stdlib.h>     // malloc, free
+#include <stdint.h>     // uintptr_t
+#include <stdio.h>      // printf
+#include <assert.h>
+#include <atomic>
+#include <mutex>
+#include <thread>       // std::thread::id, slot owners
+
+#define MEMORY_MAX_THREADS              80  // Job workers + a few external threads (audio, loading)
+
+#define FRAME_ALLOCATOR_BUFFER_COUNT    3   // Current frame + the one the render thread reads + one in flight
+#define FRAME_ALLOCATOR_DEFAULT_SIZE    (1024 * 1024)   // Per thread, per buffered frame
+
+#ifndef MOSS_MEMORY_TRACKING
+#define MOSS_MEMORY_TRACKING            1
+#endif
+
+// Allocation tags
+#define MEMORY_TAG_GENERAL              0
+#define MEMORY_TAG_TEXTURES             1
+#define MEMORY_TAG_AUDIO                2
+#define MEMORY_TAG_PHYSICS              3
+#define MEMORY_TAG_GUI                  4
+#define MEMORY_TAG_SCRIPTS              5
+#define MEMORY_TAG_COUNT                6
+
+static inline const char* MemoryTagName(int tag) {
+    static const char* names[MEMORY_TAG_COUNT] = { "General", "Textures", "Audio", "Physics", "GUI", "Scripts" };
+    return (tag >= 0 && tag < MEMORY_TAG_COUNT) ? names[tag] : "Unknown";
+}
+
+struct MemoryTagStats
+{
+    size_t  LiveBytes;
+    size_t  LiveCount;
+    size_t  PeakBytes;              // High-water mark since startup
+    size_t  FrameAllocBytes;        // Allocated during the last complete frame
+    size_t  FrameAllocCount;
+    size_t  TotalAllocCount;
+};
+
+class MemoryTracker;
+inline MemoryTracker& GetMemoryTracker();
+
+class MemoryTracker
+{
+public:
+    MemoryTracker() : ThreadCount(0), SharedCounters(nullptr) {
+        for (int i = 0; i < MEMORY_TAG_COUNT; i++) {
+            Tags[i].LiveBytes.store(0);
+            Tags[i].PeakBytes.store(0);
+            LastFrameBytes[i] = LastFrameCount[i] = 0;
+            FrameStartBytes[i] = FrameStartCount[i] = 0;
+        }
+        for (int i = 0; i < MEMORY_MAX_THREADS; i++)
+            Threads[i] = nullptr;
+    }
+
+    // One shared atomic per call, the rest goes to counters only this thread writes.
+    void on_alloc(int tag, size_t size) {
+        ThreadCounters* t = get_thread_counters();
+        bump(t, t->AllocBytes[tag], size);
+        bump(t, t->AllocCount[tag], 1);
+
+        TagCounters& c = Tags[tag];
+        const size_t live = c.LiveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+        // Only contended while the mark is actually rising
+        size_t peak = c.PeakBytes.load(std::memory_order_relaxed);
+        while (live > peak && !c.PeakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+    }
+
+    void on_free(int tag, size_t size) {
+        ThreadCounters* t = get_thread_counters();
+        bump(t, t->FreeCount[tag], 1);
+        Tags[tag].LiveBytes.fetch_sub(size, std::memory_order_relaxed);
+    }
+
+    // Latches the per frame counters. Call once per frame from the main thread.
+    void begin_frame() {
+        for (int i = 0; i < MEMORY_TAG_COUNT; i++) {
+            const size_t bytes = sum(&ThreadCounters::AllocBytes, i);
+            const size_t count = sum(&ThreadCounters::AllocCount, i);
+            LastFrameBytes[i] = bytes - FrameStartBytes[i];
+            LastFrameCount[i] = count - FrameStartCount[i];
+            FrameStartBytes[i] = bytes;
+            FrameStartCount[i] = count;
+        }
+    }
+
+    MemoryTagStats get_tag_stats(int tag) const {
+        assert(tag >= 0 && tag < MEMORY_TAG_COUNT);
+        MemoryTagStats s;
+        s.LiveBytes = Tags[tag].LiveBytes.load(std::memory_order_relaxed);
+        s.TotalAllocCount = sum(&ThreadCounters::AllocCount, tag);
+        s.LiveCount = s.TotalAllocCount - sum(&ThreadCounters::FreeCount, tag);
+        s.PeakBytes = Tags[tag].PeakBytes.load(std::memory_order_relaxed);
+        s.FrameAllocBytes = LastFrameBytes[tag];
+        s.FrameAllocCount = LastFrameCount[tag];
+        return s;
+    }
+
+    size_t get_live_bytes() const {
+        size_t total = 0;
+        for (int i = 0; i < MEMORY_TAG_COUNT; i++)
+            total += Tags[i].LiveBytes.load(std::memory_order_relaxed);
+        return total;
+    }
+
+    size_t get_frame_alloc_bytes() const {
+        size_t total = 0;
+        for (int i = 0; i < MEMORY_TAG_COUNT; i++)
+            total += LastFrameBytes[i];
+        return total;
+    }
+
+    // Prints every tag that still owns memory. Returns the number of leaked allocations.
+    size_t report_leaks() const {
+        size_t leaked = 0;
+        for (int i = 0; i < MEMORY_TAG_COUNT; i++) {
+            const MemoryTagStats s = get_tag_stats(i);
+            if (s.LiveCount == 0)
+                continue;
+            printf("Memory leak: %-8s %zu allocations, %zu bytes (peak %zu bytes)\n", MemoryTagName(i), s.LiveCount, s.LiveBytes, s.PeakBytes);
+            leaked += s.LiveCount;
+        }
+        return leaked;
+    }
+
+private:
+    // One cache line per tag so threads working on different subsystems don't share lines.
+    // Padded rather than alignas(64), the tracker is heap allocated and C++14 new ignores extended alignment.
+    struct TagCounters
+    {
+        std::atomic<size_t> LiveBytes;
+        std::atomic<size_t> PeakBytes;
+        uint8               Pad[64 - 2 * sizeof(std::atomic<size_t>)];
+    };
+
+    // Written by the owning thread only, read by anyone. Frees may happen on
+    // another thread than the alloc, so only the sums over all threads mean anything.
+    // A thread that exits leaves its counters to the next new thread: the counts carry
+    // on, the sums stay right and the slots never run out.
+    struct ThreadCounters
+    {
+        uint8               PadBefore[64];      // Keeps the neighbouring heap block off these lines
+        std::atomic<size_t> AllocBytes[MEMORY_TAG_COUNT];
+        std::atomic<size_t> AllocCount[MEMORY_TAG_COUNT];
+        std::atomic<size_t> FreeCount[MEMORY_TAG_COUNT];
+        bool                Free;               // Owner exited, under Mutex
+        bool                Shared;             // Past MEMORY_MAX_THREADS live threads, several writers
+        uint8               PadAfter[64];
+    };
+
+    // Gives the counters back when the thread exits. The tracker is never destroyed.
+    struct ThreadRelease
+    {
+        ~ThreadRelease() { GetMemoryTracker().release_thread_counters(tls_counters()); }
+    };
+
+    // Single writer: a plain load/store, no locked instruction. The shared slot pays for the atomic add.
+    static void bump(ThreadCounters* t, std::atomic<size_t>& counter, size_t value) {
+        if (t->Shared)
+            counter.fetch_add(value, std::memory_order_relaxed);
+        else
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    size_t sum(std::atomic<size_t> (ThreadCounters::*field)[MEMORY_TAG_COUNT], int tag) const {
+        size_t total = 0;
+        const int count = ThreadCount.load(std::memory_order_acquire);
+        for (int i = 0; i < count; i++)
+            total += (Threads[i]->*field)[tag].load(std::memory_order_relaxed);
+        const ThreadCounters* shared = SharedCounters.load(std::memory_order_acquire);
+        if (shared)
+            total += (shared->*field)[tag].load(std::memory_order_relaxed);
+        return total;
+    }
+
+    static ThreadCounters*& tls_counters() { static thread_local ThreadCounters* counters = nullptr; return counters; }
+
+    ThreadCounters* get_thread_counters() {
+        ThreadCounters*& counters = tls_counters();
+        if (counters)
+            return counters;
+
+        static thread_local ThreadRelease release;
+        (void)release;
+        std::lock_guard<std::mutex> lock(Mutex);
+        const int count = ThreadCount.load(std::memory_order_relaxed);
+        for (int i = 0; i < count; i++) {
+            if (Threads[i]->Free) {
+                Threads[i]->Free = false;
+                counters = Threads[i];
+                return counters;
+            }
+        }
+        if (count < MEMORY_MAX_THREADS) {
+            counters = new_thread_counters(false);
+            Threads[count] = counters;
+            ThreadCount.store(count + 1, std::memory_order_release);
+            return counters;
+        }
+        counters = get_shared_counters();
+        return counters;
+    }
+
+    // Later allocations of the exiting thread (other thread_local destructors) go to the shared slot.
+    void release_thread_counters(ThreadCounters*& counters) {
+        std::lock_guard<std::mutex> lock(Mutex);
+        if (counters && !counters->Shared)
+            counters->Free = true;
+        counters = get_shared_counters();
+    }
+
+    // Under Mutex
+    ThreadCounters* get_shared_counters() {
+        ThreadCounters* shared = SharedCounters.load(std::memory_order_relaxed);
+        if (!shared) {
+            shared = new_thread_counters(true);
+            SharedCounters.store(shared, std::memory_order_release);
+        }
+        return shared;
+    }
+
+    static ThreadCounters* new_thread_counters(bool shared) {
+        ThreadCounters* counters = new ThreadCounters();
+        for (int i = 0; i < MEMORY_TAG_COUNT; i++) {
+            counters->AllocBytes[i].store(0);
+            counters->AllocCount[i].store(0);
+            counters->FreeCount[i].store(0);
+        }
+        counters->Free = false;
+        counters->Shared = shared;
+        return counters;
+    }
+
+    TagCounters                     Tags[MEMORY_TAG_COUNT];
+    ThreadCounters*                 Threads[MEMORY_MAX_THREADS];
+    std::atomic<int>                ThreadCount;
+    std::atomic<ThreadCounters*>    SharedCounters;
+    std::mutex                      Mutex;
+    size_t                          LastFrameBytes[MEMORY_TAG_COUNT];
+    size_t                          LastFrameCount[MEMORY_TAG_COUNT];
+    size_t                          FrameStartBytes[MEMORY_TAG_COUNT];
+    size_t                          FrameStartCount[MEMORY_TAG_COUNT];
+};
+
+// The engine wide tracker. Never destroyed, containers in other statics still free into it during exit.
+inline MemoryTracker& GetMemoryTracker() { static MemoryTracker* tracker = new MemoryTracker(); return *tracker; }
+
+#if MOSS_MEMORY_TRACKING
+// Sits in front of every tagged allocation so Memory_Free() knows what to untrack. 16 bytes keeps malloc's alignment.
+struct MemoryHeader
+{
+    size_t  Size;
+    size_t  Tag;
+};
+
+static inline void* Memory_Alloc(size_t size, int tag = MEMORY_TAG_GENERAL) {
+    MemoryHeader* header = (MemoryHeader*)malloc(sizeof(MemoryHeader) + size);
+    if (!header)
+        return nullptr;
+    header->Size = size;
+    header->Tag = (size_t)tag;
+    GetMemoryTracker().on_alloc(tag, size);
+    return header + 1;
+}
+
+static inline void Memory_Free(void* ptr) {
+    if (!ptr)
+        return;
+    MemoryHeader* header = (MemoryHeader*)ptr - 1;
+    GetMemoryTracker().on_free((int)header->Tag, header->Size);
+    free(header);
+}
+
+static inline size_t Memory_GetSize(const void* ptr) { return ptr ? ((const MemoryHeader*)ptr - 1)->Size : 0; }
+#else
+static inline void*  Memory_Alloc(size_t size, int = MEMORY_TAG_GENERAL)   { return malloc(size); }
+static inline void   Memory_Free(void* ptr)                                { free(ptr); }
+static inline size_t Memory_GetSize(const void*)                           { return 0; }
+#endif
+
+// TArray allocation policy, static so TArray stays 16 bytes.
+template<int TAG>
+struct TaggedHeap
+{
+    static void* alloc(size_t size)  { return Memory_Alloc(size, TAG); }
+    static void  free(void* ptr)     { Memory_Free(ptr); }
+};
+
+typedef TaggedHeap<MEMORY_TAG_GENERAL> HeapAllocator;
+
+class FrameAllocator
+{
+public:
+    FrameAllocator() : FrameIndex(0), BlockSize(0), ThreadCount(0), Generation(0), AllocatedLastFrame(0) {
+        for (int i = 0; i <= MEMORY_MAX_THREADS; i++)
+            Threads[i] = nullptr;
+    }
+    ~FrameAllocator() { shutdown(); }
+
+    // 'block_size' is what each thread gets per frame before falling back to overflow blocks.
+    void init(size_t block_size = FRAME_ALLOCATOR_DEFAULT_SIZE) {
+        BlockSize = block_size;
+    }
+
+    // Threads' cached arenas are dropped too (new generation), allocating afterwards starts over.
+    void shutdown() {
+        std::lock_guard<std::mutex> lock(Mutex);
+        for (int i = 0; i <= MEMORY_MAX_THREADS; i++) {
+            if (!Threads[i])
+                continue;
+            for (int f = 0; f < FRAME_ALLOCATOR_BUFFER_COUNT; f++) {
+                release_overflow(Threads[i]->Arenas[f]);
+                ::free(Threads[i]->Arenas[f].Base);
+            }
+            delete Threads[i];
+            Threads[i] = nullptr;
+        }
+        ThreadCount.store(0);
+        Generation.fetch_add(1, std::memory_order_release);
+    }
+
+    // Memory stays valid until begin_frame() has been called FRAME_ALLOCATOR_BUFFER_COUNT times. Never freed individually.
+    void* alloc(size_t size, size_t align = 16) {
+        ThreadData* data = get_thread_data();
+        if (data->Shared) {
+            std::lock_guard<std::mutex> lock(Mutex);
+            return alloc_from(data->Arenas[FrameIndex], size, align);
+        }
+        return alloc_from(data->Arenas[FrameIndex], size, align);
+    }
+
+    template<typename T> T* alloc_array(int count) { return (T*)alloc(sizeof(T) * count, alignof(T)); }
+
+    // Call once per frame from the main thread, while no other thread allocates.
+    // Reuses the oldest buffer: O(1) per thread, unless it overflowed last time.
+    void begin_frame() {
+        AllocatedLastFrame = get_bytes_allocated();
+
+        const int count = ThreadCount.load(std::memory_order_acquire);
+        FrameIndex = (FrameIndex + 1) % FRAME_ALLOCATOR_BUFFER_COUNT;
+        for (int i = 0; i < count; i++)
+            reset_arena(Threads[i]->Arenas[FrameIndex]);
+        if (Threads[MEMORY_MAX_THREADS])
+            reset_arena(Threads[MEMORY_MAX_THREADS]->Arenas[FrameIndex]);
+    }
+
+    // Bytes allocated so far this frame. Only exact when no other thread is allocating.
+    size_t get_bytes_allocated() const {
+        size_t total = 0;
+        const int count = ThreadCount.load(std::memory_order_acquire);
+        for (int i = 0; i < count; i++)
+            total += Threads[i]->Arenas[FrameIndex].Allocated;
+        if (Threads[MEMORY_MAX_THREADS])
+            total += Threads[MEMORY_MAX_THREADS]->Arenas[FrameIndex].Allocated;
+        return total;
+    }
+
+    size_t get_bytes_allocated_last_frame() const { return AllocatedLastFrame; }
+    int    get_frame_index() const               { return FrameIndex; }
+
+private:
+    struct OverflowBlock
+    {
+        OverflowBlock* Next;
+    };
+
+    struct Arena
+    {
+        uint8*          Base;
+        size_t          Size;
+        size_t          Used;
+        size_t          Allocated;      // Requested bytes, for stats
+        OverflowBlock*  Overflow;       // malloc'd when Base was full
+        size_t          OverflowBytes;
+    };
+
+    struct ThreadData
+    {
+        Arena           Arenas[FRAME_ALLOCATOR_BUFFER_COUNT];
+        std::thread::id Owner;          // Default id once the thread exited, the next new thread takes the slot over
+        bool            Shared;         // Past MEMORY_MAX_THREADS live threads: one slot for all of them, under Mutex
+    };
+
+    // Trivial so the fast path costs no thread_local init guard
+    struct ThreadCache
+    {
+        ThreadData*     Data;
+        FrameAllocator* Owner;
+        uint32          Generation;
+        bool            Exited;         // The slot went back, later allocations (other thread_local destructors) share
+    };
+
+    // Gives the slot back when its thread exits. The allocator must outlive the threads that used it.
+    struct ThreadRelease
+    {
+        ~ThreadRelease() {
+            ThreadCache& cache = tls_cache();
+            if (cache.Data)
+                cache.Owner->release_thread_data(cache.Data, cache.Generation);
+            cache.Data = nullptr;
+            cache.Exited = true;
+        }
+    };
+
+    static ThreadCache& tls_cache() { static thread_local ThreadCache cache = { nullptr, nullptr, 0, false }; return cache; }
+
+    void* alloc_from(Arena& arena, size_t size, size_t align) {
+        uintptr_t p = ((uintptr_t)arena.Base + arena.Used + (align - 1)) & ~(uintptr_t)(align - 1);
+        size_t end = (size_t)(p - (uintptr_t)arena.Base) + size;
+        if (arena.Base && end <= arena.Size) {
+            arena.Used = end;
+            arena.Allocated += size;
+            return (void*)p;
+        }
+        return alloc_overflow(arena, size, align);
+    }
+
+    static void reset_arena(Arena& arena) {
+        if (arena.Overflow) {
+            // Grow so next time it fits in one block
+            const size_t needed = arena.Size + arena.OverflowBytes;
+            release_overflow(arena);
+            ::free(arena.Base);
+            arena.Base = (uint8*)malloc(needed);
+            arena.Size = needed;
+        }
+        arena.Used = 0;
+        arena.Allocated = 0;
+    }
+
+    ThreadData* get_thread_data() {
+        ThreadCache& cache = tls_cache();
+        if (cache.Data && cache.Owner == this && cache.Generation == Generation.load(std::memory_order_acquire))
+            return cache.Data;
+
+        if (!cache.Exited) {
+            static thread_local ThreadRelease release;
+            (void)release;
+        }
+        std::lock_guard<std::mutex> lock(Mutex);
+        ThreadData* data = acquire_thread_data(cache.Exited);
+        if (!cache.Exited) {
+            cache.Data = data;
+            cache.Owner = this;
+            cache.Generation = Generation.load(std::memory_order_relaxed);
+        }
+        return data;
+    }
+
+    // Under Mutex. Prefers the calling thread's own slot (it switched allocators), then one
+    // a finished thread left, then a new one, then the shared one.
+    ThreadData* acquire_thread_data(bool exited) {
+        const std::thread::id self = std::this_thread::get_id();
+        const int count = ThreadCount.load(std::memory_order_relaxed);
+        if (!exited) {
+            for (int i = 0; i < count; i++)
+                if (Threads[i]->Owner == self)
+                    return Threads[i];
+            for (int i = 0; i < count; i++) {
+                if (Threads[i]->Owner == std::thread::id()) {
+                    Threads[i]->Owner = self;
+                    return Threads[i];
+                }
+            }
+            if (count < MEMORY_MAX_THREADS) {
+                Threads[count] = new_thread_data(self, false);
+                ThreadCount.store(count + 1, std::memory_order_release);
+                return Threads[count];
+            }
+        }
+        if (!Threads[MEMORY_MAX_THREADS])
+            Threads[MEMORY_MAX_THREADS] = new_thread_data(std::thread::id(), true);
+        return Threads[MEMORY_MAX_THREADS];
+    }
+
+    ThreadData* new_thread_data(std::thread::id owner, bool shared) {
+        ThreadData* data = new ThreadData();
+        for (int f = 0; f < FRAME_ALLOCATOR_BUFFER_COUNT; f++) {
+            Arena& arena = data->Arenas[f];
+            arena.Size = BlockSize ? BlockSize : FRAME_ALLOCATOR_DEFAULT_SIZE;
+            arena.Base = (uint8*)malloc(arena.Size);
+            arena.Used = arena.Allocated = arena.OverflowBytes = 0;
+            arena.Overflow = nullptr;
+        }
+        data->Owner = owner;
+        data->Shared = shared;
+        return data;
+    }
+
+    // The arenas stay as they are, what the thread allocated lives its usual frames.
+    void release_thread_data(ThreadData* data, uint32 generation) {
+        std::lock_guard<std::mutex> lock(Mutex);
+        if (generation == Generation.load(std::memory_order_relaxed) && !data->Shared)
+            data->Owner = std::thread::id();
+    }
+
+    void* alloc_overflow(Arena& arena, size_t size, size_t align) {
+        OverflowBlock* block = (OverflowBlock*)malloc(sizeof(OverflowBlock) + size + align);
+        block->Next = arena.Overflow;
+        arena.Overflow = block;
+        arena.OverflowBytes += size + align;
+        arena.Allocated += size;
+        return (void*)(((uintptr_t)(block + 1) + (align - 1)) & ~(uintptr_t)(align - 1));
+    }
+
+    static void release_overflow(Arena& arena) {
+        while (arena.Overflow) {
+            OverflowBlock* next = arena.Overflow->Next;
+            ::free(arena.Overflow);
+            arena.Overflow = next;
+        }
+        arena.OverflowBytes = 0;
+    }
+
+    int                 FrameIndex;
+    size_t              BlockSize;
+    ThreadData*         Threads[MEMORY_MAX_THREADS + 1];    // The last one is the shared slot
+    std::atomic<int>    ThreadCount;
+    std::atomic<uint32> Generation;                         // Bumped by shutdown(), invalidates every thread's cache
+    std::mutex          Mutex;
+    size_t              AllocatedLastFrame;
+};
+
+// The engine wide frame allocator
+inline FrameAllocator& GetFrameAllocator() { static FrameAllocator allocator; return allocator; }
+
+// TArray policy: growing abandons the old block, freeing is a no-op.
+struct FrameHeap
+{
+    static void* alloc(size_t size)  { return GetFrameAllocator().alloc(size); }
+    static void  free(void*)         {}
+};
+
+#endif // MEMORY_H
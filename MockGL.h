@@ -0,0 +1,241 @@
+//                        MIT License
+//
+//                  Copyright (c) 2024 Toby
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////
+/*                  MockGL.h
+
+          Test only, no engine header includes it.
+
+          A GL driver that does nothing, for running
+          the GL backends headless. Every stub counts
+          its calls in GetMockGL():
+
+          gladLoadGLLoader((GLADloadproc)MockGL_Loader);
+          GPUStateCache state(GetGPUStateBackend(GPU_STATE_BACKEND_GL));
+          ...
+          uint64 issued = GetMockGL().state_calls();
+
+          Links sleep for LinkCostUs and binary loads
+          for LoadCostUs, so ShaderCache hits, misses
+          and the startup time saved can be measured.
+          A program binary only loads under the
+          DriverVersion it was made with, change it to
+          simulate a driver update.
+
+          One loader serves every backend, entry
+          points nothing uses stay NULL.
+*/
+////////////////////////////////////////////////
+
+#ifndef MOCK_GL_H
+#define MOCK_GL_H
+
+#include "Variants.h"
+#include "thirdparty/glad/glad.h"
+
+#include <chrono>
+#include <string.h>     // strcmp, strlen, memcpy
+#include <thread>       // sleep_for, the compile cost
+
+#define MOCK_GL_VERSION             "4.6.0 Moss mock 1.0"
+
+// Calls that reached the mock driver, by GL entry point
+struct MockGL
+{
+    uint64          UseProgram;
+    uint64          ActiveTexture;
+    uint64          BindTexture;
+    uint64          BindVertexArray;
+    uint64          Enable;
+    uint64          Disable;
+    uint64          BlendFuncSeparate;
+    uint64          BlendEquation;
+    uint64          DepthFunc;
+    uint64          DepthMask;
+    uint64          Scissor;
+
+    uint64          CompileShader;
+    uint64          LinkProgram;
+    uint64          GetProgramBinary;
+    uint64          ProgramBinary;
+    uint64          ProgramBinaryRejected;
+
+    int             LinkCostUs;             // What a real compile and link takes
+    int             LoadCostUs;             // What glProgramBinary() takes
+    const char*     DriverVersion;          // GL_VERSION
+    TArray<uint64>  SourceHashes;           // By shader or program name - 1
+    TArray<uint8>   Linked;
+
+    MockGL() : UseProgram(0), ActiveTexture(0), BindTexture(0), BindVertexArray(0), Enable(0), Disable(0), BlendFuncSeparate(0),
+               BlendEquation(0), DepthFunc(0), DepthMask(0), Scissor(0),
+               CompileShader(0), LinkProgram(0), GetProgramBinary(0), ProgramBinary(0), ProgramBinaryRejected(0),
+               LinkCostUs(2000), LoadCostUs(50), DriverVersion(MOCK_GL_VERSION) {}
+
+    // What GPUStateCache issued
+    uint64 state_calls() const {
+        return UseProgram + ActiveTexture + BindTexture + BindVertexArray + Enable + Disable
+             + BlendFuncSeparate + BlendEquation + DepthFunc + DepthMask + Scissor;
+    }
+};
+
+static inline MockGL& GetMockGL() {
+    static MockGL mock;
+    return mock;
+}
+
+// glad asks for the version and the extension list before loading anything else
+static const GLubyte* APIENTRY MockGL_GetString(GLenum name) {
+    return (const GLubyte*)(name == GL_VERSION ? GetMockGL().DriverVersion : name == GL_EXTENSIONS ? "GL_MOSS_mock" : "Moss mock");
+}
+static const GLubyte* APIENTRY MockGL_GetStringi(GLenum, GLuint) { return (const GLubyte*)"GL_MOSS_mock"; }
+static void APIENTRY MockGL_GetIntegerv(GLenum name, GLint* data) { *data = (name == GL_NUM_EXTENSIONS || name == GL_NUM_PROGRAM_BINARY_FORMATS) ? 1 : 0; }
+
+// - State
+static void APIENTRY MockGL_UseProgram(GLuint)                                  { GetMockGL().UseProgram++; }
+static void APIENTRY MockGL_ActiveTexture(GLenum)                               { GetMockGL().ActiveTexture++; }
+static void APIENTRY MockGL_BindTexture(GLenum, GLuint)                         { GetMockGL().BindTexture++; }
+static void APIENTRY MockGL_BindVertexArray(GLuint)                             { GetMockGL().BindVertexArray++; }
+static void APIENTRY MockGL_Enable(GLenum)                                      { GetMockGL().Enable++; }
+static void APIENTRY MockGL_Disable(GLenum)                                     { GetMockGL().Disable++; }
+static void APIENTRY MockGL_BlendFuncSeparate(GLenum, GLenum, GLenum, GLenum)   { GetMockGL().BlendFuncSeparate++; }
+static void APIENTRY MockGL_BlendEquation(GLenum)                               { GetMockGL().BlendEquation++; }
+static void APIENTRY MockGL_DepthFunc(GLenum)                                   { GetMockGL().DepthFunc++; }
+static void APIENTRY MockGL_DepthMask(GLboolean)                                { GetMockGL().DepthMask++; }
+static void APIENTRY MockGL_Scissor(GLint, GLint, GLsizei, GLsizei)             { GetMockGL().Scissor++; }
+
+// - Shaders
+static inline uint64 MockGL_Hash64(const void* data, size_t size, uint64 seed = 14695981039346656037ull) {
+    const uint8* p = (const uint8*)data;
+    for (size_t i = 0; i < size; i++)
+        seed = (seed ^ p[i]) * 1099511628211ull;
+    return seed;
+}
+
+static inline GLuint MockGL_NewName() {
+    MockGL& mock = GetMockGL();
+    mock.SourceHashes.push_back(MockGL_Hash64(nullptr, 0));
+    mock.Linked.push_back(0);
+    return (GLuint)mock.SourceHashes.size();
+}
+
+static inline uint64 MockGL_DriverHash() { const char* v = GetMockGL().DriverVersion; return MockGL_Hash64(v, strlen(v)); }
+
+static GLuint APIENTRY MockGL_CreateShader(GLenum) { return MockGL_NewName(); }
+static GLuint APIENTRY MockGL_CreateProgram()      { return MockGL_NewName(); }
+static void APIENTRY MockGL_DeleteShader(GLuint)   {}
+static void APIENTRY MockGL_DeleteProgram(GLuint)  {}
+static void APIENTRY MockGL_ProgramParameteri(GLuint, GLenum, GLint) {}
+
+static void APIENTRY MockGL_ShaderSource(GLuint shader, GLsizei count, const GLchar* const* strings, const GLint* lengths) {
+    uint64 hash = MockGL_Hash64(nullptr, 0);
+    for (GLsizei i = 0; i < count; i++)
+        hash = MockGL_Hash64(strings[i], lengths ? (size_t)lengths[i] : strlen(strings[i]), hash);
+    GetMockGL().SourceHashes[shader - 1] = hash;
+}
+static void APIENTRY MockGL_CompileShader(GLuint) { GetMockGL().CompileShader++; }
+static void APIENTRY MockGL_AttachShader(GLuint program, GLuint shader) {
+    MockGL& mock = GetMockGL();
+    mock.SourceHashes[program - 1] = MockGL_Hash64(&mock.SourceHashes[shader - 1], sizeof(uint64), mock.SourceHashes[program - 1]);
+}
+static void APIENTRY MockGL_LinkProgram(GLuint program) {
+    MockGL& mock = GetMockGL();
+    mock.LinkProgram++;
+    mock.Linked[program - 1] = 1;
+    std::this_thread::sleep_for(std::chrono::microseconds(mock.LinkCostUs));
+}
+
+static void APIENTRY MockGL_GetShaderiv(GLuint, GLenum, GLint* params) { *params = GL_TRUE; }
+static void APIENTRY MockGL_GetProgramiv(GLuint program, GLenum name, GLint* params) {
+    if (name == GL_LINK_STATUS)
+        *params = GetMockGL().Linked[program - 1];
+    else if (name == GL_PROGRAM_BINARY_LENGTH)
+        *params = 2 * sizeof(uint64);
+    else
+        *params = 0;
+}
+static void APIENTRY MockGL_GetInfoLog(GLuint, GLsizei size, GLsizei* length, GLchar* log) { if (size > 0) log[0] = 0; if (length) *length = 0; }
+
+// The binary is the driver hash and the program's source hash
+static void APIENTRY MockGL_GetProgramBinary(GLuint program, GLsizei size, GLsizei* length, GLenum* format, void* binary) {
+    MockGL& mock = GetMockGL();
+    mock.GetProgramBinary++;
+    const uint64 data[2] = { MockGL_DriverHash(), mock.SourceHashes[program - 1] };
+    const GLsizei written = size < (GLsizei)sizeof(data) ? 0 : (GLsizei)sizeof(data);
+    memcpy(binary, data, written);
+    if (length)
+        *length = written;
+    *format = 0x4D4F;
+}
+static void APIENTRY MockGL_ProgramBinary(GLuint program, GLenum format, const void* binary, GLsizei length) {
+    MockGL& mock = GetMockGL();
+    mock.ProgramBinary++;
+    std::this_thread::sleep_for(std::chrono::microseconds(mock.LoadCostUs));
+    uint64 data[2] = { 0, 0 };
+    const bool ok = format == 0x4D4F && length == (GLsizei)sizeof(data) && (memcpy(data, binary, sizeof(data)), data[0] == MockGL_DriverHash());
+    mock.Linked[program - 1] = ok ? 1 : 0;
+    if (ok)
+        mock.SourceHashes[program - 1] = data[1];
+    else
+        mock.ProgramBinaryRejected++;
+}
+
+// Loader for gladLoadGLLoader()
+static inline void* MockGL_Loader(const char* name) {
+    static const struct { const char* Name; void* Proc; } procs[] = {
+        { "glGetString",            (void*)MockGL_GetString },
+        { "glGetStringi",           (void*)MockGL_GetStringi },
+        { "glGetIntegerv",          (void*)MockGL_GetIntegerv },
+        { "glUseProgram",           (void*)MockGL_UseProgram },
+        { "glActiveTexture",        (void*)MockGL_ActiveTexture },
+        { "glBindTexture",          (void*)MockGL_BindTexture },
+        { "glBindVertexArray",      (void*)MockGL_BindVertexArray },
+        { "glEnable",               (void*)MockGL_Enable },
+        { "glDisable",              (void*)MockGL_Disable },
+        { "glBlendFuncSeparate",    (void*)MockGL_BlendFuncSeparate },
+        { "glBlendEquation",        (void*)MockGL_BlendEquation },
+        { "glDepthFunc",            (void*)MockGL_DepthFunc },
+        { "glDepthMask",            (void*)MockGL_DepthMask },
+        { "glScissor",              (void*)MockGL_Scissor },
+        { "glCreateShader",         (void*)MockGL_CreateShader },
+        { "glDeleteShader",         (void*)MockGL_DeleteShader },
+        { "glShaderSource",         (void*)MockGL_ShaderSource },
+        { "glCompileShader",        (void*)MockGL_CompileShader },
+        { "glGetShaderiv",          (void*)MockGL_GetShaderiv },
+        { "glGetShaderInfoLog",     (void*)MockGL_GetInfoLog },
+        { "glCreateProgram",        (void*)MockGL_CreateProgram },
+        { "glDeleteProgram",        (void*)MockGL_DeleteProgram },
+        { "glProgramParameteri",    (void*)MockGL_ProgramParameteri },
+        { "glAttachShader",         (void*)MockGL_AttachShader },
+        { "glLinkProgram",          (void*)MockGL_LinkProgram },
+        { "glGetProgramiv",         (void*)MockGL_GetProgramiv },
+        { "glGetProgramInfoLog",    (void*)MockGL_GetInfoLog },
+        { "glGetProgramBinary",     (void*)MockGL_GetProgramBinary },
+        { "glProgramBinary",        (void*)MockGL_ProgramBinary },
+    };
+    for (size_t i = 0; i < sizeof(procs) / sizeof(procs[0]); i++)
+        if (strcmp(procs[i].Name, name) == 0)
+            return procs[i].Proc;
+    return nullptr;
+}
+
+#endif // MOCK_GL_H
@@ -471,15 +471,16 @@ typedef int Window_MouseModeFlag;       // -> enum Window_MouseMode_
 typedef int Window_FocusModeFlag;       // -> enum Window_FocusMode_
 
 
-/*! @brief Creates a window.
+/*! @brief Creates a window. With 'share' it joins that window's share group:
+ *  textures, shaders and font atlases are uploaded once for all of them (GPUResources.h).
  *  @ingroup window
  */
 Moss_window* Moss_CreateWindow(int width, int height, const char* title, int flags, Moss_window* share);
 
-/*! @brief Creates a window popup.
+/*! @brief Creates a window popup, sharing resources like Moss_CreateWindow().
  *  @ingroup window
  */
-Moss_window* Moss_CreatePopup(int width, int height, const char* title, int flags, window* share);
+Moss_window* Moss_CreatePopup(int width, int height, const char* title, int flags, Moss_window* share);
 /*! @brief Sets window as current.
  *  @ingroup window
  */
@@ -526,6 +527,11 @@ void setWindowCursorShape(int mode);
 void setWindowCursorMode(int mode);
 
 
+/*! @brief Installs the platform input callbacks.
+ *  They only timestamp and push into GetInputEventQueue() (Input.h),
+ *  the simulation drains it. Nothing game side runs inside PollEvents().
+ *  @ingroup input
+ */
 void Moss_setKeyCallbacks();
 void Moss_setMouseCallbacks();
 void Moss_setCursorCallbacks();
@@ -0,0 +1,297 @@
+//                        MIT License
+//
+//                  Copyright (c) 2024 Toby
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////
+/*                  Object.h
+
+          Base class of every node, and the property
+          registry used by Tween, animation and the editor.
+
+          Properties are registered once per class with
+          their byte offset. Look a name up once to get a
+          PropertyHandle, after that a get/set is a pointer
+          offset plus a load/store.
+
+          class Sprite2D : public Object
+          {
+              MOSS_CLASS(Sprite2D, Object)
+              static void _bind_properties(ClassInfo& info) {
+                  BIND_PROPERTY(info, position);
+                  BIND_PROPERTY(info, modulate);
+              }
+          public:
+              Vector2 position;
+              Color   modulate;
+          };
+
+          PropertyHandle h = Sprite2D::get_class_info_static().get_property_handle("position");
+          h.set_value(sprite, Vector2(10, 10));
+*/
+////////////////////////////////////////////////
+
+#ifndef OBJECT_H
+#define OBJECT_H
+
+#include "Variants.h"
+
+#include <string.h>     // strcmp
+
+// FNV-1a, usable in constant expressions: HashStr("position") is folded at compile time.
+constexpr uint32 HashStr(const char* str, uint32 seed = 2166136261u) { return *str ? HashStr(str + 1, (seed ^ (uint32)(uint8)*str) * 16777619u) : seed; }
+
+// How the field is laid out in memory. Variant stores int64/double, fields are often int/float.
+enum PropertyStorage
+{
+    PROPERTY_STORAGE_NONE,
+    PROPERTY_STORAGE_BOOL,
+    PROPERTY_STORAGE_INT32,
+    PROPERTY_STORAGE_INT64,
+    PROPERTY_STORAGE_FLOAT,
+    PROPERTY_STORAGE_DOUBLE,
+    PROPERTY_STORAGE_VALUE,     // Stored as the Variant type itself (vectors, colors, ...)
+};
+
+// Field type -> (VariantType, PropertyStorage)
+template<typename T> struct PropertyTypeInfo { static const VariantType Type = VariantTypeInfo<T>::Type; static const PropertyStorage Storage = PROPERTY_STORAGE_VALUE; };
+template<> struct PropertyTypeInfo<bool>     { static const VariantType Type = VARIANT_BOOL;  static const PropertyStorage Storage = PROPERTY_STORAGE_BOOL; };
+template<> struct PropertyTypeInfo<int>      { static const VariantType Type = VARIANT_INT;   static const PropertyStorage Storage = PROPERTY_STORAGE_INT32; };
+template<> struct PropertyTypeInfo<int64>    { static const VariantType Type = VARIANT_INT;   static const PropertyStorage Storage = PROPERTY_STORAGE_INT64; };
+template<> struct PropertyTypeInfo<float>    { static const VariantType Type = VARIANT_FLOAT; static const PropertyStorage Storage = PROPERTY_STORAGE_FLOAT; };
+template<> struct PropertyTypeInfo<double>   { static const VariantType Type = VARIANT_FLOAT; static const PropertyStorage Storage = PROPERTY_STORAGE_DOUBLE; };
+
+struct PropertyInfo
+{
+    const char*     Name;
+    uint32          NameHash;
+    VariantType     Type;
+    PropertyStorage Storage;
+    uint32          Offset;     // From the Object* of the owning class
+};
+
+struct Object;
+
+// A resolved property. Cheap to copy, keep it instead of the name.
+struct PropertyHandle
+{
+    uint32          Offset;
+    VariantType     Type;
+    PropertyStorage Storage;
+
+    PropertyHandle() : Offset(0), Type(VARIANT_NIL), Storage(PROPERTY_STORAGE_NONE) {}
+    PropertyHandle(const PropertyInfo& info) : Offset(info.Offset), Type(info.Type), Storage(info.Storage) {}
+
+    bool is_valid() const { return Storage != PROPERTY_STORAGE_NONE; }
+
+    // Typed access, T must be the exact field type.
+    template<typename T> T* get_ptr(Object* object) const {
+        assert(is_valid() && PropertyTypeInfo<T>::Type == Type && PropertyTypeInfo<T>::Storage == Storage);
+        return reinterpret_cast<T*>(reinterpret_cast<char*>(object) + Offset);
+    }
+    template<typename T> const T* get_ptr(const Object* object) const {
+        assert(is_valid() && PropertyTypeInfo<T>::Type == Type && PropertyTypeInfo<T>::Storage == Storage);
+        return reinterpret_cast<const T*>(reinterpret_cast<const char*>(object) + Offset);
+    }
+    template<typename T> void set_value(Object* object, const T& value) const  { *get_ptr<T>(object) = value; }
+    template<typename T> const T& get_value(const Object* object) const      { return *get_ptr<T>(object); }
+
+    // Generic access for scripts and Tween. Numbers are converted, other types must match.
+    bool set(Object* object, const Variant& value) const {
+        char* ptr = reinterpret_cast<char*>(object) + Offset;
+        switch (Storage) {
+        case PROPERTY_STORAGE_BOOL:     *reinterpret_cast<bool*>(ptr) = value.to_bool(); return true;
+        case PROPERTY_STORAGE_INT32:    *reinterpret_cast<int*>(ptr) = (int)value.to_int(); return true;
+        case PROPERTY_STORAGE_INT64:    *reinterpret_cast<int64*>(ptr) = value.to_int(); return true;
+        case PROPERTY_STORAGE_FLOAT:    *reinterpret_cast<float*>(ptr) = (float)value.to_float(); return true;
+        case PROPERTY_STORAGE_DOUBLE:   *reinterpret_cast<double*>(ptr) = value.to_float(); return true;
+        case PROPERTY_STORAGE_VALUE:
+            if (value.get_type() != Type)
+                return false;
+            switch (Type) {
+            case VARIANT_VECTOR2:   *reinterpret_cast<Vector2*>(ptr) = value.get<Vector2>(); return true;
+            case VARIANT_VECTOR2I:  *reinterpret_cast<Vector2i*>(ptr) = value.get<Vector2i>(); return true;
+            case VARIANT_VECTOR3:   *reinterpret_cast<Vector3*>(ptr) = value.get<Vector3>(); return true;
+            case VARIANT_VECTOR3I:  *reinterpret_cast<Vector3i*>(ptr) = value.get<Vector3i>(); return true;
+            case VARIANT_VECTOR4:   *reinterpret_cast<Vector4*>(ptr) = value.get<Vector4>(); return true;
+            case VARIANT_VECTOR4I:  *reinterpret_cast<Vector4i*>(ptr) = value.get<Vector4i>(); return true;
+            case VARIANT_RECT:      *reinterpret_cast<Rect*>(ptr) = value.get<Rect>(); return true;
+            case VARIANT_RECTI:     *reinterpret_cast<Recti*>(ptr) = value.get<Recti>(); return true;
+            case VARIANT_COLOR:     *reinterpret_cast<Color*>(ptr) = value.get<Color>(); return true;
+            case VARIANT_AABB2:     *reinterpret_cast<AABB2*>(ptr) = value.get<AABB2>(); return true;
+            case VARIANT_OBJECT:    *reinterpret_cast<Object**>(ptr) = value.get<Object*>(); return true;
+            case VARIANT_AABB3:     *reinterpret_cast<AABB3*>(ptr) = value.get<AABB3>(); return true;
+            case VARIANT_TRANSFORM2D: *reinterpret_cast<Transform2D*>(ptr) = value.get<Transform2D>(); return true;
+            case VARIANT_TRANSFORM3D: *reinterpret_cast<Transform3D*>(ptr) = value.get<Transform3D>(); return true;
+            case VARIANT_ARRAY:     *reinterpret_cast<VariantArray*>(ptr) = value.get<VariantArray>(); return true;
+            case VARIANT_DICTIONARY: *reinterpret_cast<VariantDictionary*>(ptr) = value.get<VariantDictionary>(); return true;
+            case VARIANT_CURVE:     *reinterpret_cast<Curve*>(ptr) = value.get<Curve>(); return true;
+            case VARIANT_CURVE2D:   *reinterpret_cast<Curve2D*>(ptr) = value.get<Curve2D>(); return true;
+            case VARIANT_CURVE3D:   *reinterpret_cast<Curve3D*>(ptr) = value.get<Curve3D>(); return true;
+            default: return false;
+            }
+        default: return false;
+        }
+    }
+
+    Variant get(const Object* object) const {
+        const char* ptr = reinterpret_cast<const char*>(object) + Offset;
+        switch (Storage) {
+        case PROPERTY_STORAGE_BOOL:     return Variant(*reinterpret_cast<const bool*>(ptr));
+        case PROPERTY_STORAGE_INT32:    return Variant(*reinterpret_cast<const int*>(ptr));
+        case PROPERTY_STORAGE_INT64:    return Variant(*reinterpret_cast<const int64*>(ptr));
+        case PROPERTY_STORAGE_FLOAT:    return Variant(*reinterpret_cast<const float*>(ptr));
+        case PROPERTY_STORAGE_DOUBLE:   return Variant(*reinterpret_cast<const double*>(ptr));
+        case PROPERTY_STORAGE_VALUE:
+            switch (Type) {
+            case VARIANT_VECTOR2:   return Variant(*reinterpret_cast<const Vector2*>(ptr));
+            case VARIANT_VECTOR2I:  return Variant(*reinterpret_cast<const Vector2i*>(ptr));
+            case VARIANT_VECTOR3:   return Variant(*reinterpret_cast<const Vector3*>(ptr));
+            case VARIANT_VECTOR3I:  return Variant(*reinterpret_cast<const Vector3i*>(ptr));
+            case VARIANT_VECTOR4:   return Variant(*reinterpret_cast<const Vector4*>(ptr));
+            case VARIANT_VECTOR4I:  return Variant(*reinterpret_cast<const Vector4i*>(ptr));
+            case VARIANT_RECT:      return Variant(*reinterpret_cast<const Rect*>(ptr));
+            case VARIANT_RECTI:     return Variant(*reinterpret_cast<const Recti*>(ptr));
+            case VARIANT_COLOR:     return Variant(*reinterpret_cast<const Color*>(ptr));
+            case VARIANT_AABB2:     return Variant(*reinterpret_cast<const AABB2*>(ptr));
+            case VARIANT_OBJECT:    return Variant(*reinterpret_cast<Object* const*>(ptr));
+            case VARIANT_AABB3:     return Variant(*reinterpret_cast<const AABB3*>(ptr));
+            case VARIANT_TRANSFORM2D: return Variant(*reinterpret_cast<const Transform2D*>(ptr));
+            case VARIANT_TRANSFORM3D: return Variant(*reinterpret_cast<const Transform3D*>(ptr));
+            case VARIANT_ARRAY:     return Variant(*reinterpret_cast<const VariantArray*>(ptr));
+            case VARIANT_DICTIONARY: return Variant(*reinterpret_cast<const VariantDictionary*>(ptr));
+            case VARIANT_CURVE:     return Variant(*reinterpret_cast<const Curve*>(ptr));
+            case VARIANT_CURVE2D:   return Variant(*reinterpret_cast<const Curve2D*>(ptr));
+            case VARIANT_CURVE3D:   return Variant(*reinterpret_cast<const Curve3D*>(ptr));
+            default: return Variant();
+            }
+        default: return Variant();
+        }
+    }
+};
+
+struct ClassInfo
+{
+    typedef void (*BindFunc)(ClassInfo& info);
+
+    const char*             Name;
+    uint32                  NameHash;
+    const ClassInfo*        Parent;
+    TArray<PropertyInfo>    Properties;     // Sorted by NameHash
+
+    ClassInfo(const char* name, const ClassInfo* parent, BindFunc bind) : Name(name), NameHash(HashStr(name)), Parent(parent) {
+        if (bind)
+            bind(*this);
+    }
+
+    // Registers 'member' of class C. C must derive from Object (single inheritance, Object first).
+    template<typename C, typename T>
+    void add_property(const char* name, T C::* member) {
+        PropertyInfo info;
+        info.Name = name;
+        info.NameHash = HashStr(name);
+        info.Type = PropertyTypeInfo<T>::Type;
+        info.Storage = PropertyTypeInfo<T>::Storage;
+        info.Offset = member_offset(member);
+
+        // Keep sorted for the binary search in find_property(), names that collide stay next to each other
+        int i = 0;
+        while (i < Properties.size() && Properties[i].NameHash < info.NameHash)
+            i++;
+        for (int j = i; j < Properties.size() && Properties[j].NameHash == info.NameHash; j++)
+            assert(strcmp(Properties[j].Name, name) != 0); // Duplicate name
+        Properties.insert(Properties.begin() + i, info);
+    }
+
+    // Searches this class then its parents. The hash finds the candidates, the name confirms them.
+    const PropertyInfo* find_property(const char* name) const {
+        const uint32 name_hash = HashStr(name);
+        for (const ClassInfo* c = this; c; c = c->Parent) {
+            int lo = 0, hi = c->Properties.size();
+            while (lo < hi) {
+                const int mid = (lo + hi) / 2;
+                if (c->Properties[mid].NameHash < name_hash)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            for (int i = lo; i < c->Properties.size() && c->Properties[i].NameHash == name_hash; i++)
+                if (strcmp(c->Properties[i].Name, name) == 0)
+                    return &c->Properties[i];
+        }
+        return nullptr;
+    }
+
+    PropertyHandle get_property_handle(const char* name) const {
+        const PropertyInfo* info = find_property(name);
+        return info ? PropertyHandle(*info) : PropertyHandle();
+    }
+
+    bool is_a(const ClassInfo* other) const {
+        for (const ClassInfo* c = this; c; c = c->Parent)
+            if (c == other)
+                return true;
+        return false;
+    }
+
+private:
+    // Offset of the member relative to the Object base of C. Uses a fake non-null address, nothing is dereferenced.
+    template<typename C, typename T>
+    static uint32 member_offset(T C::* member) {
+        C* fake = reinterpret_cast<C*>((uintptr_t)0x1000);
+        return (uint32)(reinterpret_cast<uintptr_t>(&(fake->*member)) - reinterpret_cast<uintptr_t>(static_cast<Object*>(fake)));
+    }
+};
+
+// Put at the top of every class deriving from Object. The class must define
+// 'static void _bind_properties(ClassInfo& info)' (it can be empty).
+#define MOSS_CLASS(CLASS, PARENT) \
+public: \
+    typedef CLASS SelfType; \
+    static const ClassInfo& get_class_info_static() { static ClassInfo info(#CLASS, &PARENT::get_class_info_static(), &CLASS::_bind_properties); return info; } \
+    virtual const ClassInfo* get_class_info() const override { return &get_class_info_static(); } \
+private:
+
+#define BIND_PROPERTY(INFO, MEMBER) (INFO).add_property(#MEMBER, &SelfType::MEMBER)
+
+struct Object
+{
+    virtual ~Object() {}
+
+    static const ClassInfo& get_class_info_static() { static ClassInfo info("Object", nullptr, nullptr); return info; }
+    virtual const ClassInfo* get_class_info() const { return &get_class_info_static(); }
+
+    const char* get_class() const { return get_class_info()->Name; }
+    bool        is_class(const ClassInfo& info) const { return get_class_info()->is_a(&info); }
+
+    // By name, hashes and searches on every call. Resolve a PropertyHandle for anything per-frame.
+    bool set(const char* property, const Variant& value) {
+        PropertyHandle h = get_class_info()->get_property_handle(property);
+        return h.is_valid() && h.set(this, value);
+    }
+
+    Variant get(const char* property) const {
+        PropertyHandle h = get_class_info()->get_property_handle(property);
+        return h.is_valid() ? h.get(this) : Variant();
+    }
+};
+
+#endif // OBJECT_H
@@ -0,0 +1,289 @@
+//                        MIT License
+//
+//                  Copyright (c) 2024 Toby
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////
+/*                  Platform.h
+
+          Backend behind Moss_CreateWindow(),
+          PollEvents(), SwapBuffers(), ...
+
+          PLATFORM_BACKEND_HEADLESS needs no display:
+          the window is a fixed size virtual
+          framebuffer in memory, SwapBuffers() only
+          counts frames and can simulate vsync. Input
+          comes from the event queue (replays).
+
+          Windows created with a share window (and
+          popups) join its share group: one
+          GPUSharedResources (GPUResources.h) per
+          group, torn down with its last window.
+
+          Moss_SetPlatformBackend(PLATFORM_BACKEND_HEADLESS);
+          // or run with MOSS_HEADLESS=1 in the environment
+          // or no native backend has been registered
+
+          #define MOSS_PLATFORM_IMPLEMENTATION in one .cpp
+          before including this to get the definitions.
+*/
+////////////////////////////////////////////////
+
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include "Moss.h"
+#include "Memory.h"     // Memory_Alloc, MEMORY_TAG_TEXTURES
+#include "GPUResources.h"
+
+#define PLATFORM_BACKEND_NATIVE     0
+#define PLATFORM_BACKEND_HEADLESS   1
+
+// One per windowing system. Native backends fill this in and register it.
+struct PlatformBackend
+{
+    const char*     Name;
+    bool            (*create_window)(Moss_window* window);     // Size, title and flags are already set
+    void            (*destroy_window)(Moss_window* window);
+    void            (*make_context_current)(Moss_window* window);
+    void            (*poll_events)(void);
+    void            (*swap_buffers)(Moss_window* window);
+    int             ResourceBackend;    // GPU_RESOURCE_BACKEND_*, what the share group uploads through
+};
+
+struct Moss_window
+{
+    const PlatformBackend*  Backend;
+    void*                   Handle;             // Native window, null when headless
+    int                     Width;
+    int                     Height;
+    const char*             Title;
+    int                     Flags;
+    bool                    ShouldClose;
+    Moss_window*            Share;
+    GPUSharedResources*     Resources;          // Same pointer for every window of the share group
+    bool                    Popup;
+    uint32*                 Framebuffer;        // Headless: Width * Height RGBA8, what a software renderer draws into
+    uint64                  FrameCount;         // SwapBuffers() calls
+    uint64                  LastSwapNs;
+};
+
+/*! @brief Picks the backend used by the next Moss_CreateWindow(). Returns false if it isn't available.
+ *  @ingroup window
+ */
+bool Moss_SetPlatformBackend(int backend);
+
+/*! @brief Makes a native backend available as PLATFORM_BACKEND_NATIVE.
+ *  @ingroup window
+ */
+void Moss_RegisterNativeBackend(const PlatformBackend* backend);
+
+int  Moss_GetPlatformBackend(void);
+
+/*! @brief Simulated vsync for headless windows, SwapBuffers() waits for the next refresh. 0 = off (default).
+ *  @ingroup window
+ */
+void Moss_SetHeadlessRefreshRate(int hz);
+
+/*! @brief Headless windows report they should close after 'frames' SwapBuffers(), 0 = never.
+ *  @ingroup window
+ */
+void Moss_SetHeadlessFrameLimit(uint64 frames);
+
+void Moss_DestroyWindow(Moss_window* window);
+void Moss_SetWindowShouldClose(Moss_window* window, bool value);
+
+#endif // PLATFORM_H
+
+#ifdef MOSS_PLATFORM_IMPLEMENTATION
+#ifndef MOSS_PLATFORM_IMPLEMENTATION_DONE
+#define MOSS_PLATFORM_IMPLEMENTATION_DONE
+
+#include <stdio.h>      // fprintf
+#include <stdlib.h>     // getenv
+#include <string.h>     // memset
+#include <new>          // placement new
+#include <chrono>
+#include <thread>
+
+struct PlatformState
+{
+    const PlatformBackend*  Native;
+    int                     Backend;
+    bool                    BackendChosen;
+    Moss_window*            Current;
+    Moss_window*            Windows[16];        // For PollEvents() and the frame limit
+    int                     WindowCount;
+    int                     HeadlessRefreshRate;
+    uint64                  HeadlessFrameLimit;
+};
+
+static PlatformState GPlatform = { nullptr, PLATFORM_BACKEND_HEADLESS, false, nullptr, { nullptr }, 0, 0, 0 };
+
+static uint64 Platform_GetTimeNs() {
+    return (uint64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Headless
+static bool Headless_CreateWindow(Moss_window* window) {
+    const size_t size = (size_t)window->Width * window->Height * sizeof(uint32);
+    window->Framebuffer = (uint32*)Memory_Alloc(size, MEMORY_TAG_TEXTURES);
+    if (!window->Framebuffer)
+        return false;
+    memset(window->Framebuffer, 0, size);
+    return true;
+}
+
+static void Headless_DestroyWindow(Moss_window* window) {
+    Memory_Free(window->Framebuffer);
+    window->Framebuffer = nullptr;
+}
+
+static void Headless_MakeContextCurrent(Moss_window*) {}
+static void Headless_PollEvents(void) {}
+
+static void Headless_SwapBuffers(Moss_window* window) {
+    if (GPlatform.HeadlessRefreshRate > 0 && window->LastSwapNs) {
+        const uint64 period = 1000000000ull / (uint64)GPlatform.HeadlessRefreshRate;
+        const uint64 target = window->LastSwapNs + period;
+        const uint64 now = Platform_GetTimeNs();
+        if (now < target)
+            std::this_thread::sleep_for(std::chrono::nanoseconds(target - now));
+    }
+}
+
+static const PlatformBackend GHeadlessBackend = {
+    "Headless", Headless_CreateWindow, Headless_DestroyWindow, Headless_MakeContextCurrent, Headless_PollEvents, Headless_SwapBuffers, GPU_RESOURCE_BACKEND_NULL
+};
+
+static const PlatformBackend* Platform_GetBackend() {
+    if (!GPlatform.BackendChosen) {
+        // Servers and CI opt in without code changes
+        const char* env = getenv("MOSS_HEADLESS");
+        const bool headless = (env && env[0] && env[0] != '0') || !GPlatform.Native;
+        GPlatform.Backend = headless ? PLATFORM_BACKEND_HEADLESS : PLATFORM_BACKEND_NATIVE;
+        GPlatform.BackendChosen = true;
+    }
+    return GPlatform.Backend == PLATFORM_BACKEND_NATIVE ? GPlatform.Native : &GHeadlessBackend;
+}
+
+bool Moss_SetPlatformBackend(int backend) {
+    if (backend == PLATFORM_BACKEND_NATIVE && !GPlatform.Native)
+        return false;
+    GPlatform.Backend = backend;
+    GPlatform.BackendChosen = true;
+    return true;
+}
+
+void Moss_RegisterNativeBackend(const PlatformBackend* backend) { GPlatform.Native = backend; }
+int  Moss_GetPlatformBackend(void)                               { Platform_GetBackend(); return GPlatform.Backend; }
+void Moss_SetHeadlessRefreshRate(int hz)                         { GPlatform.HeadlessRefreshRate = hz; }
+void Moss_SetHeadlessFrameLimit(uint64 frames)                   { GPlatform.HeadlessFrameLimit = frames; }
+
+Moss_window* Moss_CreateWindow(int width, int height, const char* title, int flags, Moss_window* share) {
+    if (width <= 0 || height <= 0 || GPlatform.WindowCount >= (int)(sizeof(GPlatform.Windows) / sizeof(GPlatform.Windows[0]))) {
+        fprintf(stderr, "Moss_CreateWindow: invalid size or too many windows.\n");
+        return nullptr;
+    }
+    Moss_window* window = (Moss_window*)Memory_Alloc(sizeof(Moss_window), MEMORY_TAG_GENERAL);
+    if (!window)
+        return nullptr;
+    memset(window, 0, sizeof(Moss_window));
+    window->Backend = Platform_GetBackend();
+    window->Width = width;
+    window->Height = height;
+    window->Title = title;
+    window->Flags = flags;
+    window->Share = share;
+    if (!window->Backend->create_window(window)) {
+        fprintf(stderr, "Moss_CreateWindow: %s backend failed to create '%s'.\n", window->Backend->Name, title ? title : "");
+        Memory_Free(window);
+        return nullptr;
+    }
+    if (share && share->Resources && share->Backend == window->Backend) {
+        window->Resources = share->Resources;
+    }
+    else {
+        if (share)
+            fprintf(stderr, "Moss_CreateWindow: '%s' can't share with a window of another backend.\n", title ? title : "");
+        window->Resources = new (Memory_Alloc(sizeof(GPUSharedResources), MEMORY_TAG_GENERAL)) GPUSharedResources(GetGPUResourceBackend(window->Backend->ResourceBackend));
+    }
+    window->Resources->attach(window);
+    GPlatform.Windows[GPlatform.WindowCount++] = window;
+    return window;
+}
+
+Moss_window* Moss_CreatePopup(int width, int height, const char* title, int flags, Moss_window* share) {
+    Moss_window* window = Moss_CreateWindow(width, height, title, flags, share);
+    if (window)
+        window->Popup = true;
+    return window;
+}
+
+void Moss_DestroyWindow(Moss_window* window) {
+    if (!window)
+        return;
+    for (int i = 0; i < GPlatform.WindowCount; i++) {
+        if (GPlatform.Windows[i] == window) {
+            GPlatform.Windows[i] = GPlatform.Windows[--GPlatform.WindowCount];
+            break;
+        }
+    }
+    // Its vertex arrays live in its own context, the last window also takes the shared objects down
+    window->Backend->make_context_current(window);
+    if (window->Resources->detach(window)) {
+        window->Resources->~GPUSharedResources();
+        Memory_Free(window->Resources);
+    }
+    if (GPlatform.Current == window)
+        GPlatform.Current = nullptr;
+    else if (GPlatform.Current)
+        GPlatform.Current->Backend->make_context_current(GPlatform.Current);
+    window->Backend->destroy_window(window);
+    Memory_Free(window);
+}
+
+void Moss_MakeContextCurrent(Moss_window* window) {
+    GPlatform.Current = window;
+    if (window)
+        window->Backend->make_context_current(window);
+}
+
+bool Moss_ShouldWindowClose(Moss_window* window) {
+    if (window->Backend == &GHeadlessBackend && GPlatform.HeadlessFrameLimit && window->FrameCount >= GPlatform.HeadlessFrameLimit)
+        return true;
+    return window->ShouldClose;
+}
+
+void Moss_SetWindowShouldClose(Moss_window* window, bool value) { window->ShouldClose = value; }
+
+void PollEvents(void) {
+    Platform_GetBackend()->poll_events();
+}
+
+void SwapBuffers(Moss_window* window) {
+    window->Backend->swap_buffers(window);
+    window->FrameCount++;
+    window->LastSwapNs = Platform_GetTimeNs();
+}
+
+#endif // MOSS_PLATFORM_IMPLEMENTATION_DONE
+#endif // MOSS_PLATFORM_IMPLEMENTATION
@@ -0,0 +1,485 @@
+//                        MIT License
+//
+//                  Copyright (c) 2024 Toby
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////
+/*                  Profiler.h
+
+          Hierarchical CPU profiler.
+
+          void Physics::step() {
+              PROFILE_FUNCTION();
+              { PROFILE_SCOPE("Broadphase"); ... }
+          }
+
+          - Each thread writes finished scopes into
+            its own ring, no locks while recording
+          - end_frame() folds the rings into a timing
+            tree per thread (total/self ms, calls)
+          - start_capture()/write_chrome_trace() saves
+            every scope as Chrome trace JSON, open it
+            in chrome://tracing or ui.perfetto.dev
+          - get_overlay_rows() flattens the tree for
+            the stats overlay
+
+          Define MOSS_PROFILER 0 to compile the
+          macros out.
+*/
+////////////////////////////////////////////////
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "Variants.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>       // std::thread::id, ring owners
+#include <stdio.h>      // FILE*, fprintf
+
+#ifndef MOSS_PROFILER
+#define MOSS_PROFILER                   1
+#endif
+
+#define PROFILER_MAX_THREADS            80          // Live at once, a thread that exits hands its ring to the next one
+#define PROFILER_EVENTS_PER_THREAD      16384       // Ring per thread, power of 2. Scopes beyond this per frame are dropped.
+#define PROFILER_MAX_DEPTH              32
+#define PROFILER_MAX_CAPTURE_EVENTS     (1 << 21)   // ~64 MB of capture
+
+// A finished scope. 'Name' must outlive the profiler (string literals, __FUNCTION__).
+struct ProfileEvent
+{
+    const char*     Name;
+    uint64          StartNs;
+    uint64          EndNs;
+    uint32          Depth;
+    uint32          ThreadIndex;
+};
+
+// Aggregated per frame: every call of the same scope under the same parent adds up.
+struct ProfileNode
+{
+    const char*     Name;
+    int             Parent;
+    int             FirstChild;
+    int             NextSibling;
+    int             Depth;              // 0 = thread root
+    int             ThreadIndex;
+    int             CallCount;
+    double          TotalMs;
+    double          SelfMs;
+};
+
+struct ProfilerOverlayRow
+{
+    const char*     Name;
+    int             Depth;
+    int             CallCount;
+    double          TotalMs;
+    double          SelfMs;
+    float           Fraction;           // Of the frame, for the bar
+};
+
+class Profiler
+{
+public:
+    Profiler() : ThreadCount(0), Enabled(true), Capturing(false), FrameStartNs(0), FrameMs(0.0), DroppedEvents(0), UntrackedEvents(0) {
+        Epoch = std::chrono::steady_clock::now();
+        for (int i = 0; i < PROFILER_MAX_THREADS; i++)
+            Threads[i] = nullptr;
+    }
+    ~Profiler() {
+        for (int i = 0; i < PROFILER_MAX_THREADS; i++)
+            delete Threads[i];
+    }
+
+    uint64 now_ns() const { return (uint64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - Epoch).count(); }
+
+    void set_enabled(bool enabled) { Enabled.store(enabled, std::memory_order_relaxed); }
+    bool is_enabled() const        { return Enabled.load(std::memory_order_relaxed); }
+
+    // Shown in the trace viewer. 'name' is copied.
+    void set_thread_name(const char* name) {
+        ThreadBuffer* t = get_thread_buffer();
+        if (!t)
+            return;
+        strncpy(t->Name, name, sizeof(t->Name) - 1);
+        t->Name[sizeof(t->Name) - 1] = 0;
+    }
+
+    // Recording, lock free. Used through ProfileScope.
+    uint64 begin_scope() {
+        ThreadBuffer* t = get_thread_buffer();
+        if (t)
+            t->Depth++;
+        return now_ns();
+    }
+
+    void end_scope(const char* name, uint64 start_ns) {
+        const uint64 end_ns = now_ns();
+        ThreadBuffer* t = get_thread_buffer();
+        if (!t) {
+            UntrackedEvents.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        t->Depth--;
+        const uint64 w = t->Write.load(std::memory_order_relaxed);
+        ProfileEvent& e = t->Events[w & (PROFILER_EVENTS_PER_THREAD - 1)];
+        e.Name = name;
+        e.StartNs = start_ns;
+        e.EndNs = end_ns;
+        e.Depth = (uint32)t->Depth;
+        e.ThreadIndex = (uint32)t->Index;
+        t->Write.store(w + 1, std::memory_order_release);
+    }
+
+    void begin_frame() { FrameStartNs = now_ns(); }
+
+    // Builds the timing tree of the frame. Call from the main thread once the frame's jobs are done.
+    void end_frame() {
+        const uint64 frame_end_ns = now_ns();
+        FrameMs = (double)(frame_end_ns - FrameStartNs) * 1e-6;
+        Nodes.shrink(0);
+        FrameEvents.shrink(0);
+
+        const int count = ThreadCount.load(std::memory_order_acquire);
+        for (int i = 0; i < count; i++)
+            collect_thread(*Threads[i]);
+
+        // Parents start before their children, ties go to the outer scope
+        if (FrameEvents.size() > 1)
+            qsort(FrameEvents.begin(), FrameEvents.size(), sizeof(ProfileEvent), &Profiler::compare_events);
+
+        int thread_root[PROFILER_MAX_THREADS];
+        for (int i = 0; i < count; i++)
+            thread_root[i] = -1;
+
+        int stack[PROFILER_MAX_DEPTH];
+        const ProfileEvent* stack_events[PROFILER_MAX_DEPTH];
+        int current_thread = -1;
+        for (int i = 0; i < FrameEvents.size(); i++) {
+            const ProfileEvent& e = FrameEvents[i];
+            const int ti = (int)e.ThreadIndex;
+            if (ti != current_thread) {
+                current_thread = ti;
+                thread_root[ti] = add_node(Threads[ti]->Name, -1, 0, ti);
+                for (int d = 0; d < PROFILER_MAX_DEPTH; d++)
+                    stack_events[d] = nullptr;
+            }
+            const int depth = e.Depth < PROFILER_MAX_DEPTH ? (int)e.Depth : PROFILER_MAX_DEPTH - 1;
+
+            // The parent may have ended in another frame, hang those under the thread
+            int parent = thread_root[ti];
+            if (depth > 0 && stack_events[depth - 1] && stack_events[depth - 1]->StartNs <= e.StartNs && stack_events[depth - 1]->EndNs >= e.EndNs)
+                parent = stack[depth - 1];
+
+            const int node = find_or_add_child(parent, e.Name, ti);
+            Nodes[node].CallCount++;
+            Nodes[node].TotalMs += (double)(e.EndNs - e.StartNs) * 1e-6;
+            stack[depth] = node;
+            stack_events[depth] = &e;
+            for (int d = depth + 1; d < PROFILER_MAX_DEPTH; d++)
+                stack_events[d] = nullptr;
+
+            if (Capturing && Capture.size() < PROFILER_MAX_CAPTURE_EVENTS)
+                Capture.push_back(e);
+        }
+
+        // Thread roots span their scopes, self time is what the children don't cover
+        for (int i = Nodes.size() - 1; i >= 0; i--) {
+            ProfileNode& n = Nodes[i];
+            double children = 0.0;
+            for (int c = n.FirstChild; c >= 0; c = Nodes[c].NextSibling)
+                children += Nodes[c].TotalMs;
+            if (n.Parent < 0)
+                n.TotalMs = children;
+            n.SelfMs = n.TotalMs > children ? n.TotalMs - children : 0.0;
+        }
+    }
+
+    // Roots are the nodes with Parent == -1, one per thread that recorded this frame.
+    const TArray<ProfileNode>&  get_nodes() const           { return Nodes; }
+    double                      get_frame_ms() const        { return FrameMs; }
+    uint64                      get_dropped_events() const  { return DroppedEvents + UntrackedEvents.load(std::memory_order_relaxed); }
+
+    // Depth first, scopes below 'min_ms' and their children are skipped.
+    void get_overlay_rows(TArray<ProfilerOverlayRow>& rows, double min_ms = 0.05) const {
+        rows.shrink(0);
+        for (int i = 0; i < Nodes.size(); i++)
+            if (Nodes[i].Parent < 0)
+                add_overlay_rows(rows, i, min_ms);
+    }
+
+    // Frees the frame and capture storage, the thread rings stay until exit.
+    void shutdown() {
+        FrameEvents.clear();
+        Nodes.clear();
+        Capture.clear();
+        Capturing = false;
+    }
+
+    void start_capture() { Capture.clear(); Capturing = true; }
+    void stop_capture()  { Capturing = false; }
+    bool is_capturing() const { return Capturing; }
+    int  get_capture_event_count() const { return Capture.size(); }
+
+    // Chrome trace event format, also read by Perfetto.
+    bool write_chrome_trace(const char* path) const {
+        FILE* f = fopen(path, "wb");
+        if (!f)
+            return false;
+        fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+        // Separator before every entry but the first, valid JSON even without threads or events
+        const char* separator = "\n";
+        const int count = ThreadCount.load(std::memory_order_acquire);
+        for (int i = 0; i < count; i++) {
+            fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"", separator, i);
+            write_json_string(f, Threads[i]->Name);
+            fprintf(f, "\"}}");
+            separator = ",\n";
+        }
+        for (int i = 0; i < Capture.size(); i++) {
+            const ProfileEvent& e = Capture[i];
+            fprintf(f, "%s{\"name\":\"", separator);
+            write_json_string(f, e.Name);
+            fprintf(f, "\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", e.ThreadIndex, (double)e.StartNs * 1e-3, (double)(e.EndNs - e.StartNs) * 1e-3);
+            separator = ",\n";
+        }
+        fprintf(f, "\n]}\n");
+        return fclose(f) == 0;
+    }
+
+private:
+    struct ThreadBuffer
+    {
+        ProfileEvent            Events[PROFILER_EVENTS_PER_THREAD];
+        std::atomic<uint64>     Write;      // Owning thread only
+        uint64                  Read;       // end_frame() only
+        int                     Depth;
+        int                     Index;
+        char                    Name[32];
+        std::thread::id         Owner;      // Default id once the thread exited, under Mutex
+    };
+
+    // Trivial so the fast path costs no thread_local init guard
+    struct ThreadCache
+    {
+        ThreadBuffer*   Buffer;
+        Profiler*       Owner;
+        bool            Exited;         // The ring went back, scopes of later thread_local destructors are dropped
+    };
+
+    // Hands the ring back when its thread exits. The profiler must outlive the threads that used it.
+    struct ThreadRelease
+    {
+        ~ThreadRelease() {
+            ThreadCache& cache = tls_cache();
+            if (cache.Buffer)
+                cache.Owner->release_thread_buffer(cache.Buffer);
+            cache.Buffer = nullptr;
+            cache.Exited = true;
+        }
+    };
+
+    static ThreadCache& tls_cache() { static thread_local ThreadCache cache = { nullptr, nullptr, false }; return cache; }
+
+    // Null past PROFILER_MAX_THREADS live threads, their scopes count as dropped.
+    ThreadBuffer* get_thread_buffer() {
+        ThreadCache& cache = tls_cache();
+        if (cache.Buffer && cache.Owner == this)
+            return cache.Buffer;
+        if (cache.Exited)
+            return nullptr;
+
+        static thread_local ThreadRelease release;
+        (void)release;
+        std::lock_guard<std::mutex> lock(Mutex);
+        ThreadBuffer* buffer = acquire_thread_buffer();
+        if (buffer) {
+            cache.Buffer = buffer;
+            cache.Owner = this;
+        }
+        return buffer;
+    }
+
+    // Under Mutex. A ring a finished thread left keeps its index and events, the new owner
+    // writes on after them.
+    ThreadBuffer* acquire_thread_buffer() {
+        const std::thread::id self = std::this_thread::get_id();
+        const int count = ThreadCount.load(std::memory_order_relaxed);
+        for (int i = 0; i < count; i++)
+            if (Threads[i]->Owner == self)
+                return Threads[i];
+        for (int i = 0; i < count; i++) {
+            ThreadBuffer* buffer = Threads[i];
+            if (buffer->Owner == std::thread::id()) {
+                buffer->Owner = self;
+                buffer->Depth = 0;
+                snprintf(buffer->Name, sizeof(buffer->Name), "Thread %d", i);
+                return buffer;
+            }
+        }
+        if (count == PROFILER_MAX_THREADS)
+            return nullptr;
+        ThreadBuffer* buffer = new ThreadBuffer();
+        buffer->Write.store(0);
+        buffer->Read = 0;
+        buffer->Depth = 0;
+        buffer->Index = count;
+        buffer->Owner = self;
+        snprintf(buffer->Name, sizeof(buffer->Name), count == 0 ? "Main" : "Thread %d", count);
+        Threads[count] = buffer;
+        ThreadCount.store(count + 1, std::memory_order_release);
+        return buffer;
+    }
+
+    void release_thread_buffer(ThreadBuffer* buffer) {
+        std::lock_guard<std::mutex> lock(Mutex);
+        buffer->Owner = std::thread::id();
+    }
+
+    void collect_thread(ThreadBuffer& t) {
+        const uint64 write = t.Write.load(std::memory_order_acquire);
+        uint64 read = t.Read;
+        if (write - read > PROFILER_EVENTS_PER_THREAD) {
+            DroppedEvents += write - read - PROFILER_EVENTS_PER_THREAD;
+            read = write - PROFILER_EVENTS_PER_THREAD;
+        }
+        for (; read < write; read++)
+            FrameEvents.push_back(t.Events[read & (PROFILER_EVENTS_PER_THREAD - 1)]);
+        t.Read = write;
+    }
+
+    static int compare_events(const void* a, const void* b) {
+        const ProfileEvent* ea = (const ProfileEvent*)a;
+        const ProfileEvent* eb = (const ProfileEvent*)b;
+        if (ea->ThreadIndex != eb->ThreadIndex) return ea->ThreadIndex < eb->ThreadIndex ? -1 : 1;
+        if (ea->StartNs != eb->StartNs)         return ea->StartNs < eb->StartNs ? -1 : 1;
+        if (ea->Depth != eb->Depth)             return ea->Depth < eb->Depth ? -1 : 1;
+        return 0;
+    }
+
+    int add_node(const char* name, int parent, int depth, int thread_index) {
+        ProfileNode n;
+        n.Name = name;
+        n.Parent = parent;
+        n.FirstChild = -1;
+        n.NextSibling = -1;
+        n.Depth = depth;
+        n.ThreadIndex = thread_index;
+        n.CallCount = 0;
+        n.TotalMs = 0.0;
+        n.SelfMs = 0.0;
+        Nodes.push_back(n);
+        return Nodes.size() - 1;
+    }
+
+    // Children keep their first call order
+    int find_or_add_child(int parent, const char* name, int thread_index) {
+        int last = -1;
+        for (int c = Nodes[parent].FirstChild; c >= 0; c = Nodes[c].NextSibling) {
+            if (Nodes[c].Name == name || strcmp(Nodes[c].Name, name) == 0)
+                return c;
+            last = c;
+        }
+        const int node = add_node(name, parent, Nodes[parent].Depth + 1, thread_index);
+        if (last >= 0)
+            Nodes[last].NextSibling = node;
+        else
+            Nodes[parent].FirstChild = node;
+        return node;
+    }
+
+    void add_overlay_rows(TArray<ProfilerOverlayRow>& rows, int index, double min_ms) const {
+        const ProfileNode& n = Nodes[index];
+        if (n.Parent >= 0 && n.TotalMs < min_ms)
+            return;
+        ProfilerOverlayRow row;
+        row.Name = n.Name;
+        row.Depth = n.Depth;
+        row.CallCount = n.CallCount;
+        row.TotalMs = n.TotalMs;
+        row.SelfMs = n.SelfMs;
+        row.Fraction = FrameMs > 0.0 ? (float)(n.TotalMs / FrameMs) : 0.0f;
+        rows.push_back(row);
+        for (int c = n.FirstChild; c >= 0; c = Nodes[c].NextSibling)
+            add_overlay_rows(rows, c, min_ms);
+    }
+
+    static void write_json_string(FILE* f, const char* s) {
+        for (; *s; s++) {
+            if (*s == '"' || *s == '\\')
+                fputc('\\', f);
+            if ((unsigned char)*s >= 0x20)
+                fputc(*s, f);
+        }
+    }
+
+    std::chrono::steady_clock::time_point   Epoch;
+    ThreadBuffer*                           Threads[PROFILER_MAX_THREADS];
+    std::atomic<int>                        ThreadCount;
+    std::mutex                              Mutex;
+    std::atomic<bool>                       Enabled;
+    bool                                    Capturing;
+    uint64                                  FrameStartNs;
+    double                                  FrameMs;
+    uint64                                  DroppedEvents;
+    std::atomic<uint64>                     UntrackedEvents;    // Scopes of threads past PROFILER_MAX_THREADS
+    TArray<ProfileEvent>                    FrameEvents;
+    TArray<ProfileNode>                     Nodes;
+    TArray<ProfileEvent>                    Capture;
+};
+
+// The engine wide profiler
+inline Profiler& GetProfiler() { static Profiler profiler; return profiler; }
+
+// Records from construction to destruction. A scope started while disabled is not recorded.
+struct ProfileScope
+{
+    const char* Name;
+    uint64      StartNs;
+    bool        Active;
+
+    explicit ProfileScope(const char* name) : Name(name), StartNs(0), Active(GetProfiler().is_enabled()) {
+        if (Active)
+            StartNs = GetProfiler().begin_scope();
+    }
+    ~ProfileScope() {
+        if (Active)
+            GetProfiler().end_scope(Name, StartNs);
+    }
+};
+
+#if MOSS_PROFILER
+#define PROFILE_CONCAT_IMPL(A, B)   A##B
+#define PROFILE_CONCAT(A, B)        PROFILE_CONCAT_IMPL(A, B)
+#define PROFILE_SCOPE(NAME)         ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(NAME)
+#define PROFILE_FUNCTION()          PROFILE_SCOPE(__FUNCTION__)
+#define PROFILE_THREAD(NAME)        GetProfiler().set_thread_name(NAME)
+#else
+#define PROFILE_SCOPE(NAME)         ((void)0)
+#define PROFILE_FUNCTION()          ((void)0)
+#define PROFILE_THREAD(NAME)        ((void)0)
+#endif
+
+#endif // PROFILER_H
@@ -0,0 +1,284 @@
+//                        MIT License
+//
+//                  Copyright (c) 2024 Toby
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////
+/*                  RenderThread.h
+
+          The game thread records render commands,
+          a render thread owning the GL context
+          replays them one frame later.
+
+          RenderCommandBuffer& cmd = render.get_command_buffer();
+          cmd.push(&GL_DrawElements, &args, sizeof(args));
+          render.submit();     // Swaps buffers, never waits for the driver
+
+          Two command buffers: while the render thread
+          replays frame N the game records frame N+1.
+          submit() only blocks when the render thread
+          is a whole frame behind.
+
+          RENDER_BACKEND_NULL walks the commands
+          without calling them (headless, tests).
+*/
+////////////////////////////////////////////////
+
+#ifndef RENDER_THREAD_H
+#define RENDER_THREAD_H
+
+#include "Variants.h"
+#include "Profiler.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#define RENDER_COMMAND_ALIGN        8
+#define RENDER_BUFFER_COUNT         2
+
+typedef void (*RenderCommandFunc)(void* data);
+
+struct RenderCommandHeader
+{
+    RenderCommandFunc   Func;
+    uint32              Size;       // Payload bytes, the payload follows the header
+    uint32              Pad;
+};
+
+// Linear, reused every frame: no allocation once it has grown to the frame's size.
+class RenderCommandBuffer
+{
+public:
+    RenderCommandBuffer() : CommandCount(0) {}
+
+    // 'data' is copied, the pointer may die right after. Returns the copy, valid until the next push.
+    void* push(RenderCommandFunc func, const void* data, uint32 size) {
+        void* payload = alloc(func, size);
+        if (size)
+            memcpy(payload, data, size);
+        return payload;
+    }
+
+    // Reserves the payload to fill in place.
+    void* alloc(RenderCommandFunc func, uint32 size) {
+        const uint32 padded = (size + (RENDER_COMMAND_ALIGN - 1)) & ~(uint32)(RENDER_COMMAND_ALIGN - 1);
+        const int at = Data.size();
+        Data.resize(at + (int)sizeof(RenderCommandHeader) + (int)padded);
+        RenderCommandHeader* header = (RenderCommandHeader*)(Data.begin() + at);
+        header->Func = func;
+        header->Size = padded;
+        header->Pad = 0;
+        CommandCount++;
+        return header + 1;
+    }
+
+    template<typename T> T* alloc(RenderCommandFunc func) { return (T*)alloc(func, (uint32)sizeof(T)); }
+
+    // Calls every command in order.
+    void execute() const {
+        for (const uint8* p = Data.begin(); p < Data.end(); ) {
+            const RenderCommandHeader* header = (const RenderCommandHeader*)p;
+            header->Func((void*)(header + 1));
+            p += sizeof(RenderCommandHeader) + header->Size;
+        }
+    }
+
+    // Walks without calling, returns the command count.
+    int validate() const {
+        int count = 0;
+        for (const uint8* p = Data.begin(); p < Data.end(); count++) {
+            const RenderCommandHeader* header = (const RenderCommandHeader*)p;
+            assert(header->Func && p + sizeof(RenderCommandHeader) + header->Size <= Data.end());
+            p += sizeof(RenderCommandHeader) + header->Size;
+        }
+        return count;
+    }
+
+    void    reset()                     { Data.shrink(0); CommandCount = 0; }
+    int     get_command_count() const   { return CommandCount; }
+    int     get_size_in_bytes() const   { return Data.size(); }
+
+private:
+    TArray<uint8>   Data;
+    int             CommandCount;
+};
+
+// How the render thread gets its context and presents. Null members are skipped.
+struct RenderBackend
+{
+    const char*     Name;
+    void            (*make_current)(void* context);
+    void            (*replay)(const RenderCommandBuffer& commands);
+    void            (*present)(void* context);
+};
+
+static inline void RenderBackend_Execute(const RenderCommandBuffer& commands)   { commands.execute(); }
+static inline void RenderBackend_Validate(const RenderCommandBuffer& commands)  { commands.validate(); }
+
+#define RENDER_BACKEND_GL           0
+#define RENDER_BACKEND_NULL         1
+
+// 'present' for GL is SwapBuffers() on the window, set by whoever owns the window (see Platform.h).
+static inline RenderBackend GetRenderBackend(int type, void (*make_current)(void*) = nullptr, void (*present)(void*) = nullptr) {
+    RenderBackend backend;
+    backend.Name = type == RENDER_BACKEND_GL ? "GL" : "Null";
+    backend.make_current = type == RENDER_BACKEND_GL ? make_current : nullptr;
+    backend.replay = type == RENDER_BACKEND_GL ? &RenderBackend_Execute : &RenderBackend_Validate;
+    backend.present = type == RENDER_BACKEND_GL ? present : nullptr;
+    return backend;
+}
+
+struct RenderThreadStats
+{
+    int     CommandCount;       // Last replayed frame
+    int     CommandBytes;
+    double  ReplayMs;           // Render thread time for the frame, off the game thread when threaded
+    double  SubmitWaitMs;       // Game thread blocked in submit() waiting for the render thread
+    uint64  FramesReplayed;
+};
+
+class RenderThread
+{
+public:
+    RenderThread() : Context(nullptr), Threaded(false), Running(false), WriteIndex(0), Pending(false), Busy(false) {
+        memset(&Backend, 0, sizeof(Backend));
+        memset(&Stats, 0, sizeof(Stats));
+    }
+    ~RenderThread() { shutdown(); }
+
+    // 'threaded' false replays inside submit() on the calling thread, for comparison and single core targets.
+    void init(const RenderBackend& backend, void* context, bool threaded = true) {
+        Backend = backend;
+        Context = context;
+        Threaded = threaded;
+        WriteIndex = 0;
+        if (!Threaded) {
+            if (Backend.make_current)
+                Backend.make_current(Context);
+            return;
+        }
+        Running = true;
+        Thread = std::thread(&RenderThread::thread_main, this);
+    }
+
+    void shutdown() {
+        if (!Running)
+            return;
+        {
+            std::unique_lock<std::mutex> lock(Mutex);
+            Running = false;
+        }
+        Cond.notify_all();
+        Thread.join();
+    }
+
+    // Where the game thread records the current frame.
+    RenderCommandBuffer& get_command_buffer() { return Buffers[WriteIndex]; }
+
+    // Hands the recorded frame over and starts a new one.
+    void submit() {
+        if (!Threaded) {
+            replay(Buffers[WriteIndex]);
+            Buffers[WriteIndex].reset();
+            return;
+        }
+
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        {
+            // The other buffer is free once the render thread took the last frame and finished it
+            std::unique_lock<std::mutex> lock(Mutex);
+            Cond.wait(lock, [this] { return !Pending && !Busy; });
+            Pending = true;
+            WriteIndex ^= 1;
+        }
+        Cond.notify_all();
+        Stats.SubmitWaitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        Buffers[WriteIndex].reset();
+    }
+
+    // Blocks until everything submitted has been replayed.
+    void flush() {
+        if (!Threaded)
+            return;
+        std::unique_lock<std::mutex> lock(Mutex);
+        Cond.wait(lock, [this] { return !Pending && !Busy; });
+    }
+
+    bool                        is_threaded() const { return Threaded; }
+    // Replay figures are written by the render thread, exact after flush().
+    const RenderThreadStats&    get_stats() const   { return Stats; }
+
+private:
+    void replay(const RenderCommandBuffer& commands) {
+        PROFILE_SCOPE("RenderReplay");
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if (Backend.replay)
+            Backend.replay(commands);
+        if (Backend.present)
+            Backend.present(Context);
+        Stats.ReplayMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        Stats.CommandCount = commands.get_command_count();
+        Stats.CommandBytes = commands.get_size_in_bytes();
+        Stats.FramesReplayed++;
+    }
+
+    void thread_main() {
+        PROFILE_THREAD("Render");
+        // The GL context lives on this thread from now on
+        if (Backend.make_current)
+            Backend.make_current(Context);
+        for (;;) {
+            int index;
+            {
+                std::unique_lock<std::mutex> lock(Mutex);
+                Cond.wait(lock, [this] { return Pending || !Running; });
+                if (!Pending && !Running)
+                    return;
+                index = WriteIndex ^ 1;
+                Pending = false;
+                Busy = true;
+            }
+            replay(Buffers[index]);
+            {
+                std::unique_lock<std::mutex> lock(Mutex);
+                Busy = false;
+            }
+            Cond.notify_all();
+        }
+    }
+
+    RenderBackend               Backend;
+    void*                       Context;
+    bool                        Threaded;
+    bool                        Running;
+    RenderCommandBuffer         Buffers[RENDER_BUFFER_COUNT];
+    int                         WriteIndex;     // Game thread side, the render thread reads the other one
+    bool                        Pending;        // A submitted frame waits for the render thread
+    bool                        Busy;           // The render thread is replaying
+    std::mutex                  Mutex;
+    std::condition_variable     Cond;
+    std::thread                 Thread;
+    RenderThreadStats           Stats;
+};
+
+#endif // RENDER_THREAD_H
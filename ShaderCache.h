@@ -0,0 +1,447 @@
+//                        MIT License
+//
+//                  Copyright (c) 2024 Toby
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////
+/*                  ShaderCache.h
+
+          Shader programs by permutation, compiled
+          on first use and kept for the session.
+
+          A program is registered once with its
+          sources and the names of its switches. A
+          permutation key is a bit mask over those
+          names: bit i prepends "#define Defines[i] 1"
+          (after the #version line).
+
+          static const char* defines[] = { "USE_TEXTURE", "ALPHA_TEST" };
+          ShaderProgramDesc desc = { "sprite", sprite_vs, sprite_fs, defines, 2 };
+          int sprite = shaders.add_program(desc);
+          ...
+          state.use_program(shaders.get(sprite, 1 << 0));
+
+          With a cache directory, every linked program
+          is saved with glGetProgramBinary() and the
+          next launch loads it with glProgramBinary()
+          instead of compiling. Files are named after
+          a hash of the expanded sources and of the
+          driver (vendor, renderer, version): editing
+          a shader or updating the driver just misses.
+          A binary the driver refuses anyway is
+          recompiled and overwritten. The directory
+          must exist, nothing is created.
+
+          Call with the context current. Binaries are
+          machine specific, the header is written in
+          native byte order.
+
+          MockGL.h (test only) stands in for the
+          driver, so hits, misses and the time saved
+          can be measured headless.
+*/
+////////////////////////////////////////////////
+
+#ifndef SHADER_CACHE_H
+#define SHADER_CACHE_H
+
+#include "Variants.h"
+
+#include <chrono>
+#include <stdio.h>      // FILE*, snprintf
+#include <string.h>     // memset, strlen
+
+#define SHADER_BACKEND_GL           0
+#define SHADER_BACKEND_NULL         1
+
+#define SHADER_CACHE_MAX_DEFINES    32      // Bits of a ShaderPermutation
+#define SHADER_CACHE_MAGIC          "MOSSPRG"
+#define SHADER_CACHE_VERSION        1
+#define SHADER_CACHE_MAX_BINARY     (64 * 1024 * 1024)  // Larger sizes in a file header mean a damaged file
+
+typedef uint32 ShaderPermutation;           // Bit i enables ShaderProgramDesc::Defines[i]
+
+struct ShaderProgramDesc
+{
+    const char*         Name;
+    const char*         Vertex;
+    const char*         Fragment;
+    const char* const*  Defines;        // Switch names, indexed by permutation bit
+    int                 DefineCount;
+};
+
+struct ShaderBackend
+{
+    const char*     Name;
+    uint64          (*get_driver_hash)();                                       // Part of the disk cache key
+    uint32          (*compile)(const char* vertex, const char* fragment);       // Linked program, 0 on failure
+    bool            (*get_binary)(uint32 program, TArray<uint8>& out, uint32& format);
+    uint32          (*load_binary)(const void* data, int size, uint32 format);  // 0 when the driver refuses it
+    void            (*destroy)(uint32 program);
+};
+
+struct ShaderCacheStats
+{
+    uint64  MemoryHits;             // get() that found the variant already linked
+    uint64  DiskHits;               // Variants loaded from a saved binary
+    uint64  DiskMisses;             // No binary for these sources and driver
+    uint64  DiskRejects;            // Binary found but refused or damaged, recompiled
+    uint64  Compiles;
+    uint64  CompileFailures;
+    uint64  BinariesSaved;
+    uint64  CompileNs;              // Time spent compiling and linking
+    uint64  LoadNs;                 // Time spent reading and loading binaries
+    int     Variants;
+};
+
+// FNV-1a, 64 bit: sources are too long for HashStr()'s recursion and 32 bits is thin for a file name.
+static inline uint64 ShaderCache_Hash64(const void* data, size_t size, uint64 seed = 14695981039346656037ull) {
+    const uint8* p = (const uint8*)data;
+    for (size_t i = 0; i < size; i++)
+        seed = (seed ^ p[i]) * 1099511628211ull;
+    return seed;
+}
+
+class ShaderCache
+{
+public:
+    // 'cache_dir' nullptr keeps everything in memory.
+    ShaderCache(const ShaderBackend* backend, const char* cache_dir = nullptr) : Backend(backend), DriverHash(0), DriverKnown(false) {
+        memset(&Stats, 0, sizeof(Stats));
+        CacheDir[0] = 0;
+        if (cache_dir)
+            snprintf(CacheDir, sizeof(CacheDir), "%s", cache_dir);
+    }
+    ~ShaderCache() { clear(); }
+
+    // The desc's strings must outlive the cache.
+    int add_program(const ShaderProgramDesc& desc) {
+        assert(desc.Vertex && desc.Fragment);
+        assert(desc.DefineCount >= 0 && desc.DefineCount <= SHADER_CACHE_MAX_DEFINES);
+        Programs.push_back(desc);
+        return Programs.size() - 1;
+    }
+
+    // The linked variant, compiled or loaded on first use. 0 if it failed to build (reported once).
+    uint32 get(int program, ShaderPermutation permutation) {
+        assert(program >= 0 && program < Programs.size());
+        assert(Programs[program].DefineCount == SHADER_CACHE_MAX_DEFINES || (permutation >> Programs[program].DefineCount) == 0);
+        const uint64 key = ((uint64)program << 32) | permutation;
+        int index;
+        if (Lookup.get(key, index)) {
+            Stats.MemoryHits++;
+            return Variants[index].Id;
+        }
+        ShaderVariant variant;
+        variant.Key = key;
+        variant.Id = build(Programs[program], permutation);
+        Variants.push_back(variant);
+        Lookup.add(key, Variants.size() - 1);
+        Stats.Variants = Variants.size();
+        return variant.Id;
+    }
+
+    // A one-off program owned by the caller (free it with the backend's destroy()). Not kept in
+    // memory, but loaded from and saved to the cache directory like any variant.
+    uint32 build_program(const char* name, const char* vertex, const char* fragment) {
+        assert(vertex && fragment);
+        const ShaderProgramDesc desc = { name, vertex, fragment, nullptr, 0 };
+        return build(desc, 0);
+    }
+
+    bool has_variant(int program, ShaderPermutation permutation) const { return Lookup.contains(((uint64)program << 32) | permutation); }
+
+    // Destroys every variant, for a lost context or a shader reload. Programs stay registered.
+    void clear() {
+        for (int i = 0; i < Variants.size(); i++)
+            if (Variants[i].Id)
+                Backend->destroy(Variants[i].Id);
+        Variants.clear();
+        Lookup = TMap<uint64, int>();
+        Stats.Variants = 0;
+        DriverKnown = false;
+    }
+
+    const ShaderBackend*    get_backend() const { return Backend; }
+    const ShaderCacheStats& get_stats() const   { return Stats; }
+    void                    reset_stats()       { const int variants = Stats.Variants; memset(&Stats, 0, sizeof(Stats)); Stats.Variants = variants; }
+
+private:
+    struct ShaderVariant
+    {
+        uint64  Key;                // Program index << 32 | permutation
+        uint32  Id;                 // 0 = failed, not retried
+    };
+
+    // Native byte order, followed by Size bytes of binary
+    struct BinaryHeader
+    {
+        char    Magic[8];
+        uint32  Version;
+        uint32  Format;             // From glGetProgramBinary()
+        uint64  SourceHash;
+        uint64  DriverHash;
+        uint32  Size;
+        uint32  Pad;
+    };
+
+    static uint64 now_ns() { return (uint64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(); }
+
+    uint32 build(const ShaderProgramDesc& desc, ShaderPermutation permutation) {
+        expand(desc.Vertex, desc, permutation, VertexSource);
+        expand(desc.Fragment, desc, permutation, FragmentSource);
+        const uint64 source_hash = ShaderCache_Hash64(FragmentSource.begin(), FragmentSource.size(), ShaderCache_Hash64(VertexSource.begin(), VertexSource.size()));
+
+        const bool use_disk = CacheDir[0] != 0;
+        char path[512];
+        if (use_disk) {
+            if (!DriverKnown) {
+                DriverHash = Backend->get_driver_hash();
+                DriverKnown = true;
+            }
+            snprintf(path, sizeof(path), "%s/%016llx.glbin", CacheDir, (unsigned long long)ShaderCache_Hash64(&DriverHash, sizeof(DriverHash), source_hash));
+            const uint32 id = load(path, source_hash);
+            if (id)
+                return id;
+        }
+
+        const uint64 start = now_ns();
+        const uint32 id = Backend->compile(VertexSource.begin(), FragmentSource.begin());
+        Stats.CompileNs += now_ns() - start;
+        Stats.Compiles++;
+        if (!id) {
+            Stats.CompileFailures++;
+            fprintf(stderr, "ShaderCache: '%s' permutation 0x%x failed to build\n", desc.Name ? desc.Name : "?", permutation);
+            return 0;
+        }
+        if (use_disk)
+            save(path, id, source_hash);
+        return id;
+    }
+
+    // Version line, then the defines, then the rest with its line numbers kept.
+    static void expand(const char* source, const ShaderProgramDesc& desc, ShaderPermutation permutation, TArray<char>& out) {
+        out.shrink(0);
+        const char* body = source;
+        if (strncmp(source, "#version", 8) == 0) {
+            const char* eol = strchr(source, '\n');
+            body = eol ? eol + 1 : source + strlen(source);
+            append(out, source, (int)(body - source));
+            if (!eol)
+                append(out, "\n", 1);
+        }
+        for (int i = 0; i < desc.DefineCount; i++) {
+            if (!(permutation & (1u << i)))
+                continue;
+            append(out, "#define ", 8);
+            append(out, desc.Defines[i], (int)strlen(desc.Defines[i]));
+            append(out, " 1\n", 3);
+        }
+        char line[32];
+        const int len = snprintf(line, sizeof(line), "#line %d\n", body == source ? 1 : 2);
+        append(out, line, len);
+        append(out, body, (int)strlen(body) + 1);  // Keeps the terminator, hashed with the rest
+    }
+
+    static void append(TArray<char>& out, const char* str, int count) {
+        const int size = out.size();
+        out.resize_uninitialized(size + count);
+        memcpy(out.begin() + size, str, count);
+    }
+
+    uint32 load(const char* path, uint64 source_hash) {
+        const uint64 start = now_ns();
+        FILE* f = fopen(path, "rb");
+        if (!f) {
+            Stats.DiskMisses++;
+            return 0;
+        }
+        BinaryHeader header;
+        bool valid = fread(&header, sizeof(header), 1, f) == 1
+            && memcmp(header.Magic, SHADER_CACHE_MAGIC, sizeof(SHADER_CACHE_MAGIC)) == 0
+            && header.Version == SHADER_CACHE_VERSION && header.SourceHash == source_hash && header.DriverHash == DriverHash;
+        // The size is checked against the file before anything is allocated for it
+        if (valid) {
+            const long pos = ftell(f);
+            valid = pos >= 0 && fseek(f, 0, SEEK_END) == 0;
+            const long end = valid ? ftell(f) : -1;
+            valid = valid && end >= pos && fseek(f, pos, SEEK_SET) == 0
+                && header.Size > 0 && header.Size <= SHADER_CACHE_MAX_BINARY && header.Size <= (uint64)(end - pos);
+        }
+        if (valid) {
+            Binary.resize_uninitialized((int)header.Size);
+            valid = fread(Binary.begin(), 1, header.Size, f) == header.Size;
+        }
+        fclose(f);
+        const uint32 id = valid ? Backend->load_binary(Binary.begin(), Binary.size(), header.Format) : 0;
+        Stats.LoadNs += now_ns() - start;
+        if (!id) {
+            Stats.DiskRejects++;
+            return 0;
+        }
+        Stats.DiskHits++;
+        return id;
+    }
+
+    void save(const char* path, uint32 program, uint64 source_hash) {
+        BinaryHeader header;
+        memset(&header, 0, sizeof(header));
+        if (!Backend->get_binary(program, Binary, header.Format))
+            return;
+        memcpy(header.Magic, SHADER_CACHE_MAGIC, sizeof(SHADER_CACHE_MAGIC));
+        header.Version = SHADER_CACHE_VERSION;
+        header.SourceHash = source_hash;
+        header.DriverHash = DriverHash;
+        header.Size = (uint32)Binary.size();
+        FILE* f = fopen(path, "wb");
+        if (!f)
+            return;
+        const bool written = fwrite(&header, sizeof(header), 1, f) == 1 && fwrite(Binary.begin(), 1, Binary.size(), f) == (size_t)Binary.size();
+        if (fclose(f) == 0 && written)
+            Stats.BinariesSaved++;
+        else
+            remove(path);
+    }
+
+    const ShaderBackend*        Backend;
+    TArray<ShaderProgramDesc>   Programs;
+    TArray<ShaderVariant>       Variants;
+    TMap<uint64, int>           Lookup;         // Variant key -> index in Variants
+    TArray<char>                VertexSource;   // Scratch, kept for their capacity
+    TArray<char>                FragmentSource;
+    TArray<uint8>               Binary;
+    ShaderCacheStats            Stats;
+    uint64                      DriverHash;
+    bool                        DriverKnown;    // Asked once per context, see clear()
+    char                        CacheDir[256];
+};
+
+// Null: hands out increasing ids, no binaries, so the disk cache never hits.
+static inline uint64 ShaderNull_GetDriverHash()                                 { return 0; }
+static inline uint32 ShaderNull_Compile(const char*, const char*)               { static uint32 next = 0; return ++next; }
+static inline bool   ShaderNull_GetBinary(uint32, TArray<uint8>&, uint32&)      { return false; }
+static inline uint32 ShaderNull_LoadBinary(const void*, int, uint32)            { return 0; }
+static inline void   ShaderNull_Destroy(uint32)                                 {}
+
+#ifdef MOSS_SHADER_CACHE_GL
+#include "thirdparty/glad/glad.h"
+
+static inline uint64 ShaderGL_GetDriverHash() {
+    const GLenum names[3] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+    uint64 hash = ShaderCache_Hash64(nullptr, 0);
+    for (int i = 0; i < 3; i++) {
+        const char* str = (const char*)glGetString(names[i]);
+        if (str)
+            hash = ShaderCache_Hash64(str, strlen(str) + 1, hash);
+    }
+    return hash;
+}
+
+static inline GLuint ShaderGL_CompileStage(GLenum type, const char* source) {
+    const GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+    GLint ok = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        char log[512] = "";
+        glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+        fprintf(stderr, "ShaderCache: shader compile failed: %s\n", log);
+    }
+    return shader;
+}
+
+static inline uint32 ShaderGL_Compile(const char* vertex, const char* fragment) {
+    const GLuint vs = ShaderGL_CompileStage(GL_VERTEX_SHADER, vertex);
+    const GLuint fs = ShaderGL_CompileStage(GL_FRAGMENT_SHADER, fragment);
+    const GLuint program = glCreateProgram();
+    if (glProgramParameteri)
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glAttachShader(program, vs);
+    glAttachShader(program, fs);
+    glLinkProgram(program);
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+    GLint ok = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        char log[512] = "";
+        glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+        fprintf(stderr, "ShaderCache: program link failed: %s\n", log);
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+// Needs GL 4.1 or ARB_get_program_binary, and a driver with at least one binary format.
+static inline bool ShaderGL_GetBinary(uint32 program, TArray<uint8>& out, uint32& format) {
+    if (!glGetProgramBinary)
+        return false;
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (formats <= 0 || length <= 0)
+        return false;
+    out.resize_uninitialized(length);
+    GLsizei written = 0;
+    GLenum binary_format = 0;
+    glGetProgramBinary(program, length, &written, &binary_format, out.begin());
+    out.shrink(written);
+    format = binary_format;
+    return written > 0;
+}
+
+static inline uint32 ShaderGL_LoadBinary(const void* data, int size, uint32 format) {
+    if (!glProgramBinary)
+        return 0;
+    const GLuint program = glCreateProgram();
+    glProgramBinary(program, format, data, size);
+    GLint ok = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+static inline void ShaderGL_Destroy(uint32 program) { glDeleteProgram(program); }
+#endif // MOSS_SHADER_CACHE_GL
+
+// GL needs MOSS_SHADER_CACHE_GL (glad), without it GL falls back to the null backend.
+static inline const ShaderBackend* GetShaderBackend(int type) {
+    static const ShaderBackend null_backend = {
+        "Null", ShaderNull_GetDriverHash, ShaderNull_Compile, ShaderNull_GetBinary, ShaderNull_LoadBinary, ShaderNull_Destroy
+    };
+#ifdef MOSS_SHADER_CACHE_GL
+    static const ShaderBackend gl_backend = {
+        "GL", ShaderGL_GetDriverHash, ShaderGL_Compile, ShaderGL_GetBinary, ShaderGL_LoadBinary, ShaderGL_Destroy
+    };
+    if (type == SHADER_BACKEND_GL)
+        return &gl_backend;
+#endif
+    (void)type;
+    return &null_backend;
+}
+
+#endif // SHADER_CACHE_H
@@ -0,0 +1,580 @@
+//                        MIT License
+//
+//                  Copyright (c) 2024 Toby
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////
+/*                  SoftRaster.h
+
+          Draws DrawData on the CPU into an RGBA8
+          buffer, no GL needed: headless windows
+          (Moss_window::Framebuffer), golden image
+          tests of the GUI and 2D scenes, thumbnails.
+
+          SoftRasterizer raster;
+          raster.set_texture(atlas_id, 512, 512, 1, atlas_pixels);
+          raster.render(draw_data, window->Framebuffer, window->Width, window->Height, &jobs);
+
+          Two passes:
+          setup   - triangles become fixed point edge
+                    functions (4 bits of subpixel),
+                    clipped to their DrawCmd's ClipRect,
+                    binned into 64x64 tiles.
+          raster  - one job per tile, each walks its bin
+                    in submission order, so blending is
+                    the same whatever thread drew it.
+
+          Pixel centers are sampled with the top-left
+          fill rule, the two triangles of a quad never
+          both cover a pixel. Textures are sampled
+          nearest, clamped. Blending follows the
+          SPRITE_BLEND_* mode in DrawCmd::State.
+
+          Rows are solved for the span the triangle
+          covers, pixels inside it are shaded without
+          per pixel edge tests.
+
+          Coverage is exact integer math and each
+          tile shades in the same order, so renders
+          compare bit for bit across runs and thread
+          counts: SoftRaster_CompareImages().
+*/
+////////////////////////////////////////////////
+
+#ifndef SOFT_RASTER_H
+#define SOFT_RASTER_H
+
+#include "DrawList.h"
+#include "SpriteBatch.h"    // SPRITE_STATE_BLEND, SPRITE_BLEND_*
+
+#include <string.h>     // memset
+
+#define SOFT_RASTER_TILE_SIZE       64
+#define SOFT_RASTER_SUBPIXEL_BITS   4
+#define SOFT_RASTER_SUBPIXEL_ONE    (1 << SOFT_RASTER_SUBPIXEL_BITS)
+#define SOFT_RASTER_COORD_LIMIT     (1 << 24)       // Subpixels, keeps the edge function products in int64
+
+// Not copied, keep the pixels alive while registered.
+struct SoftTexture
+{
+    DrawTextureID   Id;
+    int             Width;
+    int             Height;
+    int             Channels;       // 1 (alpha, font atlas) or 4 (RGBA8)
+    const uint8*    Pixels;
+};
+
+struct SoftRasterStats
+{
+    int     Triangles;
+    int     TrianglesCulled;        // Degenerate, scissored away or off the target
+    int     Tiles;
+    int     BinnedTriangles;        // Triangle / tile pairs
+    int64   PixelsWritten;
+};
+
+// (a * b) / 255 rounded, exact for 0..255 inputs.
+static inline uint32 SoftRaster_Mul8(uint32 a, uint32 b) {
+    const uint32 t = a * b + 128;
+    return (t + (t >> 8)) >> 8;
+}
+
+// Pixels where a channel differs by more than 'tolerance'. 0 = identical.
+static inline int SoftRaster_CompareImages(const uint32* a, const uint32* b, int count, int tolerance) {
+    int different = 0;
+    for (int i = 0; i < count; i++) {
+        if (a[i] == b[i])
+            continue;
+        for (int shift = 0; shift < 32; shift += 8) {
+            if (Abs((int)((a[i] >> shift) & 0xFF) - (int)((b[i] >> shift) & 0xFF)) > tolerance) {
+                different++;
+                break;
+            }
+        }
+    }
+    return different;
+}
+
+class SoftRasterizer
+{
+public:
+    SoftRasterizer() : Target(nullptr), TargetWidth(0), TargetHeight(0), TilesX(0), TilesY(0), Clear(true), ClearColor(DRAW_COL32(0, 0, 0, 255)) {
+        memset(&Stats, 0, sizeof(Stats));
+    }
+
+    // Texture 0 is always white (untextured DrawList primitives).
+    void set_texture(DrawTextureID id, int width, int height, int channels, const void* pixels) {
+        assert(id != 0 && width > 0 && height > 0 && (channels == 1 || channels == 4) && pixels);
+        SoftTexture texture;
+        texture.Id = id;
+        texture.Width = width;
+        texture.Height = height;
+        texture.Channels = channels;
+        texture.Pixels = (const uint8*)pixels;
+        for (int i = 0; i < Textures.size(); i++) {
+            if (Textures[i].Id == id) {
+                Textures[i] = texture;
+                return;
+            }
+        }
+        Textures.push_back(texture);
+    }
+
+    void remove_texture(DrawTextureID id) {
+        for (int i = 0; i < Textures.size(); i++) {
+            if (Textures[i].Id == id) {
+                Textures[i] = Textures.back();
+                Textures.pop_back();
+                return;
+            }
+        }
+    }
+
+    // Off: render() draws over what the target holds.
+    void set_clear(bool clear, uint32 col = DRAW_COL32(0, 0, 0, 255)) {
+        Clear = clear;
+        ClearColor = col;
+    }
+
+    // 'pixels' is width * height RGBA8 (DRAW_COL32 order). Tiles go to 'jobs' when given.
+    void render(const DrawData& data, uint32* pixels, int width, int height, JobSystem* jobs = nullptr) {
+        memset(&Stats, 0, sizeof(Stats));
+        Target = pixels;
+        TargetWidth = width;
+        TargetHeight = height;
+        TilesX = (width + SOFT_RASTER_TILE_SIZE - 1) / SOFT_RASTER_TILE_SIZE;
+        TilesY = (height + SOFT_RASTER_TILE_SIZE - 1) / SOFT_RASTER_TILE_SIZE;
+        const int tile_count = TilesX * TilesY;
+        Stats.Tiles = tile_count;
+        if (!tile_count)
+            return;
+
+        setup(data);
+        bin();
+
+        TilePixels.resize_uninitialized(tile_count);
+        if (jobs) {
+            jobs->parallel_for(0, tile_count, 1, [this](int start, int end) {
+                for (int i = start; i < end; i++)
+                    raster_tile(i);
+            });
+        }
+        else {
+            for (int i = 0; i < tile_count; i++)
+                raster_tile(i);
+        }
+        for (int i = 0; i < tile_count; i++)
+            Stats.PixelsWritten += TilePixels[i];
+    }
+
+    const SoftRasterStats& get_stats() const { return Stats; }
+
+private:
+    struct Triangle
+    {
+        int32               A[3];           // Edge i: A*x + B*y + C >= 0 inside, x and y in subpixels
+        int32               B[3];
+        int64               C[3];           // Includes the fill rule bias
+        int                 MinX, MinY;     // Pixels, inclusive, clipped to the scissor and the target
+        int                 MaxX, MaxY;
+        float               InvArea;
+        float               U[3], V[3];
+        uint32              Col[3];
+        const SoftTexture*  Texture;        // Null = white
+        int                 Blend;
+        bool                Flat;           // One color, no interpolation
+    };
+
+    const SoftTexture* find_texture(DrawTextureID id) const {
+        if (!id)
+            return nullptr;
+        for (int i = 0; i < Textures.size(); i++)
+            if (Textures[i].Id == id)
+                return &Textures[i];
+        return nullptr;
+    }
+
+    static int to_subpixel(float v) {
+        const float s = v * (float)SOFT_RASTER_SUBPIXEL_ONE;
+        const float c = s < -(float)SOFT_RASTER_COORD_LIMIT ? -(float)SOFT_RASTER_COORD_LIMIT : s > (float)SOFT_RASTER_COORD_LIMIT ? (float)SOFT_RASTER_COORD_LIMIT : s;
+        return (int)(c >= 0.0f ? c + 0.5f : c - 0.5f);
+    }
+
+    void setup(const DrawData& data) {
+        Triangles.shrink(0);
+        const Vector2 origin = data.DisplayPos;
+        for (int l = 0; l < data.CmdLists.size(); l++) {
+            const DrawList* list = data.CmdLists[l];
+            const DrawVert* vtx = list->VtxBuffer.begin();
+            const DrawIdx* idx = list->IdxBuffer.begin();
+            for (int c = 0; c < list->CmdBuffer.size(); c++) {
+                const DrawCmd& cmd = list->CmdBuffer[c];
+                if (!cmd.ElemCount)
+                    continue;
+                // Pixel centers inside the clip rect
+                const int clip_x0 = Max(0, (int)Ceil(cmd.ClipRect.x - origin.x - 0.5f));
+                const int clip_y0 = Max(0, (int)Ceil(cmd.ClipRect.y - origin.y - 0.5f));
+                const int clip_x1 = Min(TargetWidth, (int)Ceil(cmd.ClipRect.z - origin.x - 0.5f)) - 1;
+                const int clip_y1 = Min(TargetHeight, (int)Ceil(cmd.ClipRect.w - origin.y - 0.5f)) - 1;
+                const SoftTexture* texture = find_texture(cmd.Texture);
+                const int blend = (int)SPRITE_STATE_BLEND(cmd.State);
+                Stats.Triangles += (int)cmd.ElemCount / 3;
+                if (clip_x0 > clip_x1 || clip_y0 > clip_y1) {
+                    Stats.TrianglesCulled += (int)cmd.ElemCount / 3;
+                    continue;
+                }
+                for (uint32 i = 0; i < cmd.ElemCount; i += 3) {
+                    const DrawVert* v[3] = {
+                        &vtx[idx[cmd.IdxOffset + i + 0] + cmd.VtxOffset],
+                        &vtx[idx[cmd.IdxOffset + i + 1] + cmd.VtxOffset],
+                        &vtx[idx[cmd.IdxOffset + i + 2] + cmd.VtxOffset]
+                    };
+                    if (!setup_triangle(v, origin, clip_x0, clip_y0, clip_x1, clip_y1, texture, blend))
+                        Stats.TrianglesCulled++;
+                }
+            }
+        }
+    }
+
+    bool setup_triangle(const DrawVert* v[3], const Vector2& origin, int clip_x0, int clip_y0, int clip_x1, int clip_y1, const SoftTexture* texture, int blend) {
+        int64 x[3], y[3];
+        for (int i = 0; i < 3; i++) {
+            x[i] = to_subpixel(v[i]->pos.x - origin.x);
+            y[i] = to_subpixel(v[i]->pos.y - origin.y);
+        }
+        int64 area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+        if (area == 0)
+            return false;
+        // Either winding is drawn, counter clockwise ones are flipped to clockwise (y down)
+        int order[3] = { 0, 1, 2 };
+        if (area < 0) {
+            order[1] = 2;
+            order[2] = 1;
+            Swap(x[1], x[2]);
+            Swap(y[1], y[2]);
+            area = -area;
+        }
+
+        const int64 min_x = Min(x[0], Min(x[1], x[2])), max_x = Max(x[0], Max(x[1], x[2]));
+        const int64 min_y = Min(y[0], Min(y[1], y[2])), max_y = Max(y[0], Max(y[1], y[2]));
+        const int half = SOFT_RASTER_SUBPIXEL_ONE / 2;
+        // Pixels whose center can be inside
+        const int px0 = Max(clip_x0, (int)((min_x - half + SOFT_RASTER_SUBPIXEL_ONE - 1) >> SOFT_RASTER_SUBPIXEL_BITS));
+        const int py0 = Max(clip_y0, (int)((min_y - half + SOFT_RASTER_SUBPIXEL_ONE - 1) >> SOFT_RASTER_SUBPIXEL_BITS));
+        const int px1 = Min(clip_x1, (int)((max_x - half) >> SOFT_RASTER_SUBPIXEL_BITS));
+        const int py1 = Min(clip_y1, (int)((max_y - half) >> SOFT_RASTER_SUBPIXEL_BITS));
+        if (px0 > px1 || py0 > py1)
+            return false;
+
+        Triangle tri;
+        // Edge i is opposite vertex i, its function is the weight of vertex i
+        for (int i = 0; i < 3; i++) {
+            const int a = (i + 1) % 3, b = (i + 2) % 3;
+            tri.A[i] = (int32)(y[a] - y[b]);
+            tri.B[i] = (int32)(x[b] - x[a]);
+            tri.C[i] = x[a] * y[b] - x[b] * y[a];
+            // Top-left rule: pixels exactly on an edge belong to left and top edges only
+            const bool top_left = tri.A[i] > 0 || (tri.A[i] == 0 && tri.B[i] > 0);
+            if (!top_left)
+                tri.C[i] -= 1;
+        }
+        tri.MinX = px0;
+        tri.MinY = py0;
+        tri.MaxX = px1;
+        tri.MaxY = py1;
+        tri.InvArea = 1.0f / (float)area;
+        for (int i = 0; i < 3; i++) {
+            const DrawVert* src = v[order[i]];
+            tri.U[i] = src->uv.x;
+            tri.V[i] = src->uv.y;
+            tri.Col[i] = src->col;
+        }
+        tri.Texture = texture;
+        tri.Blend = blend;
+        tri.Flat = tri.Col[0] == tri.Col[1] && tri.Col[1] == tri.Col[2];
+        Triangles.push_back(tri);
+        return true;
+    }
+
+    // Counting sort of triangle indices by tile, every bin keeps submission order.
+    void bin() {
+        const int tile_count = TilesX * TilesY;
+        BinStart.resize_uninitialized(tile_count + 1);
+        memset(BinStart.begin(), 0, (tile_count + 1) * sizeof(int));
+        for (int t = 0; t < Triangles.size(); t++) {
+            const Triangle& tri = Triangles[t];
+            for (int ty = tri.MinY / SOFT_RASTER_TILE_SIZE; ty <= tri.MaxY / SOFT_RASTER_TILE_SIZE; ty++)
+                for (int tx = tri.MinX / SOFT_RASTER_TILE_SIZE; tx <= tri.MaxX / SOFT_RASTER_TILE_SIZE; tx++)
+                    BinStart[ty * TilesX + tx + 1]++;
+        }
+        for (int i = 0; i < tile_count; i++)
+            BinStart[i + 1] += BinStart[i];
+        Stats.BinnedTriangles = BinStart[tile_count];
+
+        BinItems.resize_uninitialized(Stats.BinnedTriangles);
+        BinCursor.resize_uninitialized(tile_count);
+        memcpy(BinCursor.begin(), BinStart.begin(), tile_count * sizeof(int));
+        for (int t = 0; t < Triangles.size(); t++) {
+            const Triangle& tri = Triangles[t];
+            for (int ty = tri.MinY / SOFT_RASTER_TILE_SIZE; ty <= tri.MaxY / SOFT_RASTER_TILE_SIZE; ty++)
+                for (int tx = tri.MinX / SOFT_RASTER_TILE_SIZE; tx <= tri.MaxX / SOFT_RASTER_TILE_SIZE; tx++)
+                    BinItems[BinCursor[ty * TilesX + tx]++] = (uint32)t;
+        }
+    }
+
+    void raster_tile(int tile) {
+        const int tile_x0 = (tile % TilesX) * SOFT_RASTER_TILE_SIZE;
+        const int tile_y0 = (tile / TilesX) * SOFT_RASTER_TILE_SIZE;
+        const int tile_x1 = Min(tile_x0 + SOFT_RASTER_TILE_SIZE, TargetWidth) - 1;
+        const int tile_y1 = Min(tile_y0 + SOFT_RASTER_TILE_SIZE, TargetHeight) - 1;
+        if (Clear) {
+            for (int y = tile_y0; y <= tile_y1; y++) {
+                uint32* row = Target + (size_t)y * TargetWidth;
+                for (int x = tile_x0; x <= tile_x1; x++)
+                    row[x] = ClearColor;
+            }
+        }
+
+        int64 written = 0;
+        for (int b = BinStart[tile]; b < BinStart[tile + 1]; b++) {
+            const Triangle& tri = Triangles[(int)BinItems[b]];
+            const int x0 = Max(tri.MinX, tile_x0), x1 = Min(tri.MaxX, tile_x1);
+            const int y0 = Max(tri.MinY, tile_y0), y1 = Min(tri.MaxY, tile_y1);
+            if (x0 > x1 || y0 > y1)
+                continue;
+            written += raster_triangle(tri, x0, y0, x1, y1);
+        }
+        TilePixels[tile] = written;
+    }
+
+    int64 raster_triangle(const Triangle& tri, int x0, int y0, int x1, int y1) {
+        switch (tri.Blend) {
+        case SPRITE_BLEND_ADDITIVE:         return raster_triangle<SPRITE_BLEND_ADDITIVE>(tri, x0, y0, x1, y1);
+        case SPRITE_BLEND_MULTIPLY:         return raster_triangle<SPRITE_BLEND_MULTIPLY>(tri, x0, y0, x1, y1);
+        case SPRITE_BLEND_PREMULTIPLIED:    return raster_triangle<SPRITE_BLEND_PREMULTIPLIED>(tri, x0, y0, x1, y1);
+        default:                            return raster_triangle<SPRITE_BLEND_ALPHA>(tri, x0, y0, x1, y1);
+        }
+    }
+
+    // Per row the three edge functions are solved for the covered span, pixels inside it need no edge test.
+    // Attributes start from the barycentrics of the span's first pixel center and step by their x gradient.
+    template<int Mode>
+    int64 raster_triangle(const Triangle& tri, int x0, int y0, int x1, int y1) {
+        const int64 step = SOFT_RASTER_SUBPIXEL_ONE;
+        const int64 half = SOFT_RASTER_SUBPIXEL_ONE / 2;
+        const float dl1 = (float)(tri.A[1] * step) * tri.InvArea;
+        const float dl2 = (float)(tri.A[2] * step) * tri.InvArea;
+        const float du1 = tri.U[1] - tri.U[0], du2 = tri.U[2] - tri.U[0];
+        const float dv1 = tri.V[1] - tri.V[0], dv2 = tri.V[2] - tri.V[0];
+        const float dudx = dl1 * du1 + dl2 * du2;
+        const float dvdx = dl1 * dv1 + dl2 * dv2;
+        float col0[4], dcol1[4], dcol2[4], dcoldx[4];
+        for (int c = 0; c < 4; c++) {
+            col0[c] = (float)((tri.Col[0] >> (c * 8)) & 0xFF);
+            dcol1[c] = (float)((tri.Col[1] >> (c * 8)) & 0xFF) - col0[c];
+            dcol2[c] = (float)((tri.Col[2] >> (c * 8)) & 0xFF) - col0[c];
+            dcoldx[c] = dl1 * dcol1[c] + dl2 * dcol2[c];
+        }
+        const SoftTexture* texture = tri.Texture;
+        // Texture coordinates are stepped in texels
+        const float tw = texture ? (float)texture->Width : 0.0f, th = texture ? (float)texture->Height : 0.0f;
+        const float dtu = dudx * tw, dtv = dvdx * th;
+        int64 written = 0;
+
+        // Edge functions at the first pixel center of each row
+        int64 row_w[3];
+        for (int i = 0; i < 3; i++)
+            row_w[i] = tri.A[i] * ((int64)x0 * step + half) + tri.B[i] * ((int64)y0 * step + half) + tri.C[i];
+
+        for (int y = y0; y <= y1; y++, row_w[0] += tri.B[0] * step, row_w[1] += tri.B[1] * step, row_w[2] += tri.B[2] * step) {
+            int start = x0, end = x1;
+            for (int i = 0; i < 3; i++) {
+                const int64 w = row_w[i];
+                const int64 s = tri.A[i] * step;
+                if (s > 0) {
+                    if (w < 0)
+                        start = Max(start, x0 + first_inside(w, s, x1 - x0 + 1));
+                }
+                else if (s < 0) {
+                    end = Min(end, w < 0 ? x0 - 1 : x0 + last_inside(w, s, x1 - x0));
+                }
+                else if (w < 0) {
+                    end = x0 - 1;
+                }
+            }
+            if (start > end)
+                continue;
+
+            uint32* dst = Target + (size_t)y * TargetWidth + start;
+            uint32* dst_end = dst + (end - start + 1);
+            written += end - start + 1;
+
+            if (tri.Flat && !texture) {
+                const uint32 src = tri.Col[0];
+                if (Mode == SPRITE_BLEND_ALPHA && (src >> 24) == 255) {
+                    for (; dst != dst_end; dst++)
+                        *dst = src;
+                }
+                else {
+                    for (; dst != dst_end; dst++)
+                        *dst = blend<Mode>(src, *dst);
+                }
+                continue;
+            }
+
+            const int64 skip = (int64)(start - x0) * step;
+            const float l1 = (float)(row_w[1] + tri.A[1] * skip) * tri.InvArea;
+            const float l2 = (float)(row_w[2] + tri.A[2] * skip) * tri.InvArea;
+            const float u = tri.U[0] + l1 * du1 + l2 * du2;
+            const float v = tri.V[0] + l1 * dv1 + l2 * dv2;
+            float col[4];
+            if (!tri.Flat)
+                for (int c = 0; c < 4; c++)
+                    col[c] = col0[c] + l1 * dcol1[c] + l2 * dcol2[c];
+            float tu = u * tw, tv = v * th;
+            for (; dst != dst_end; dst++, tu += dtu, tv += dtv) {
+                uint32 src = tri.Col[0];
+                if (!tri.Flat) {
+                    src = pack_col(col);
+                    for (int c = 0; c < 4; c++)
+                        col[c] += dcoldx[c];
+                }
+                if (texture) {
+                    const size_t texel = texel_index(texture, tu, tv);
+                    if (texture->Channels == 1)
+                        src = (src & 0x00FFFFFFu) | (SoftRaster_Mul8(src >> 24, texture->Pixels[texel]) << 24);
+                    else
+                        src = modulate(src, texture_rgba(texture, texel));
+                }
+                *dst = blend<Mode>(src, *dst);
+            }
+        }
+        return written;
+    }
+
+    // Edge w + s * k >= 0 solved for the pixel step k, capped at 'limit'. The double estimate avoids
+    // a 64 bit divide per edge and row, the exact checks after it fix its rounding.
+    static int first_inside(int64 w, int64 s, int limit) {     // s > 0, w < 0: first k inside
+        const double e = (double)(-w) / (double)s;
+        if (e >= (double)limit)
+            return limit;
+        int k = (int)e;
+        while (k > 0 && w + s * (k - 1) >= 0)
+            k--;
+        while (k < limit && w + s * k < 0)
+            k++;
+        return k;
+    }
+
+    static int last_inside(int64 w, int64 s, int limit) {      // s < 0, w >= 0: last k inside
+        const double e = (double)w / (double)(-s);
+        if (e >= (double)limit)
+            return limit;
+        int k = (int)e;
+        while (k < limit && w + s * (k + 1) >= 0)
+            k++;
+        while (k > 0 && w + s * k < 0)
+            k--;
+        return k;
+    }
+
+    static uint32 pack_col(const float col[4]) {
+        uint32 packed = 0;
+        for (int c = 0; c < 4; c++) {
+            const int ci = (int)(col[c] + 0.5f);
+            packed |= (uint32)(ci < 0 ? 0 : ci > 255 ? 255 : ci) << (c * 8);
+        }
+        return packed;
+    }
+
+    // Nearest, clamped. 'tu' and 'tv' are in texels.
+    static size_t texel_index(const SoftTexture* texture, float tu, float tv) {
+        int tx = (int)tu, ty = (int)tv;
+        tx = tx < 0 ? 0 : tx >= texture->Width ? texture->Width - 1 : tx;
+        ty = ty < 0 ? 0 : ty >= texture->Height ? texture->Height - 1 : ty;
+        return (size_t)ty * texture->Width + tx;
+    }
+
+    static uint32 texture_rgba(const SoftTexture* texture, size_t texel) {
+        uint32 rgba;
+        memcpy(&rgba, texture->Pixels + texel * 4, 4);
+        return rgba;
+    }
+
+    static uint32 modulate(uint32 a, uint32 b) {
+        if (a == DRAW_COL32_WHITE)
+            return b;
+        return SoftRaster_Mul8(a & 0xFF, b & 0xFF) | (SoftRaster_Mul8((a >> 8) & 0xFF, (b >> 8) & 0xFF) << 8)
+             | (SoftRaster_Mul8((a >> 16) & 0xFF, (b >> 16) & 0xFF) << 16) | (SoftRaster_Mul8(a >> 24, b >> 24) << 24);
+    }
+
+    // The GL blend factors of each SPRITE_BLEND_* mode, in 8 bit fixed point.
+    // Alpha blending works on two channels per 32 bit lane (red|blue, green|alpha).
+    template<int Mode>
+    static uint32 blend(uint32 src, uint32 dst) {
+        const uint32 sa = src >> 24;
+        const uint32 da = dst >> 24;
+        if (Mode == SPRITE_BLEND_ALPHA) {
+            if (sa == 255)
+                return src;
+            if (sa == 0)
+                return dst;
+            // (s * sa + d * (255 - sa)) / 255 rounded, each 16 bit half holds one channel
+            uint32 rb = (src & 0x00FF00FFu) * sa + (dst & 0x00FF00FFu) * (255 - sa) + 0x00800080u;
+            uint32 g = ((src >> 8) & 0xFFu) * sa + ((dst >> 8) & 0xFFu) * (255 - sa) + 0x80u;
+            rb = ((rb + ((rb >> 8) & 0x00FF00FFu)) >> 8) & 0x00FF00FFu;
+            g = ((g + (g >> 8)) >> 8) & 0xFFu;
+            return rb | (g << 8) | ((sa + SoftRaster_Mul8(da, 255 - sa)) << 24);      // Alpha: ONE, ONE_MINUS_SRC_ALPHA
+        }
+        uint32 out = 0;
+        for (int shift = 0; shift < 24; shift += 8) {
+            const uint32 s = (src >> shift) & 0xFF, d = (dst >> shift) & 0xFF;
+            uint32 c;
+            if (Mode == SPRITE_BLEND_ADDITIVE)
+                c = Min(255u, d + SoftRaster_Mul8(s, sa));                  // SRC_ALPHA, ONE
+            else if (Mode == SPRITE_BLEND_MULTIPLY)
+                c = SoftRaster_Mul8(s, d);                                  // DST_COLOR, ZERO
+            else
+                c = Min(255u, s + SoftRaster_Mul8(d, 255 - sa));            // ONE, ONE_MINUS_SRC_ALPHA
+            out |= c << shift;
+        }
+        // Alpha is ONE, ONE_MINUS_SRC_ALPHA too, but multiply keeps the destination's
+        const uint32 a = Mode == SPRITE_BLEND_MULTIPLY ? da : Min(255u, sa + SoftRaster_Mul8(da, 255 - sa));
+        return out | (a << 24);
+    }
+
+    TArray<SoftTexture>     Textures;
+    TArray<Triangle>        Triangles;
+    TArray<int>             BinStart;       // Tile count + 1, tile i's triangles are BinItems[BinStart[i], BinStart[i + 1])
+    TArray<int>             BinCursor;
+    TArray<uint32>          BinItems;
+    TArray<int64>           TilePixels;
+    uint32*                 Target;
+    int                     TargetWidth;
+    int                     TargetHeight;
+    int                     TilesX;
+    int                     TilesY;
+    bool                    Clear;
+    uint32                  ClearColor;
+    SoftRasterStats         Stats;
+};
+
+#endif // SOFT_RASTER_H
@@ -0,0 +1,225 @@
+//                        MIT License
+//
+//                  Copyright (c) 2024 Toby
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////
+/*                  SpriteBatch.h
+
+          Batches the textured quads of a frame
+          (Sprite2D, Tilemap, CPUParticle2D, GUI)
+          into as few draw calls as possible.
+
+          Every quad gets a 64 bit sort key:
+
+          63      56 55    44 43      24 23  20 19     0
+          | layer   | shader | texture  |blend| depth  |
+
+          The keys are radix sorted, then each run of
+          quads with the same shader, texture and blend
+          becomes one DrawCmd. Layers keep their order,
+          inside a layer quads are grouped by state and
+          ordered by depth within a group.
+
+          batch.begin();
+          batch.add(layer, shader, texture, SPRITE_BLEND_ALPHA, depth, quad);
+          batch.end(list);     // Appends to the DrawList
+
+          get_stats() has the draw calls submission
+          order would have cost next to the batched
+          ones, the engine shows both (Engine.h).
+*/
+////////////////////////////////////////////////
+
+#ifndef SPRITE_BATCH_H
+#define SPRITE_BATCH_H
+
+#include "DrawList.h"
+#include "RenderThread.h"   // RenderCommandBuffer
+
+#define SPRITE_KEY_DEPTH_SHIFT      0
+#define SPRITE_KEY_BLEND_SHIFT      20
+#define SPRITE_KEY_TEXTURE_SHIFT    24
+#define SPRITE_KEY_SHADER_SHIFT     44
+#define SPRITE_KEY_LAYER_SHIFT      56
+
+#define SPRITE_KEY_DEPTH_MAX        0xFFFFFu
+#define SPRITE_KEY_BLEND_MAX        0xFu
+#define SPRITE_KEY_TEXTURE_MAX      0xFFFFFu
+#define SPRITE_KEY_SHADER_MAX       0xFFFu
+#define SPRITE_KEY_LAYER_MAX        0xFFu
+
+// Shader, texture and blend: quads with equal bits here can share a draw call
+#define SPRITE_KEY_STATE_MASK       (0xFFFFFFFFFFull << SPRITE_KEY_BLEND_SHIFT)
+
+#define SPRITE_BLEND_ALPHA          0
+#define SPRITE_BLEND_ADDITIVE       1
+#define SPRITE_BLEND_MULTIPLY       2
+#define SPRITE_BLEND_PREMULTIPLIED  3
+
+// DrawCmd::State of batched commands
+#define SPRITE_STATE(SHADER, BLEND) (((uint32)(SHADER) << 4) | (uint32)(BLEND))
+#define SPRITE_STATE_SHADER(STATE)  ((STATE) >> 4)
+#define SPRITE_STATE_BLEND(STATE)   ((STATE) & 0xFu)
+
+// Depth 0..1, larger draws later within its state group.
+static inline uint64 SpriteBatch_MakeKey(int layer, uint32 shader, DrawTextureID texture, int blend, float depth) {
+    assert(layer >= 0 && (uint32)layer <= SPRITE_KEY_LAYER_MAX && shader <= SPRITE_KEY_SHADER_MAX && texture <= SPRITE_KEY_TEXTURE_MAX && (uint32)blend <= SPRITE_KEY_BLEND_MAX);
+    const float d = depth < 0.0f ? 0.0f : depth > 1.0f ? 1.0f : depth;
+    return ((uint64)layer << SPRITE_KEY_LAYER_SHIFT) | ((uint64)shader << SPRITE_KEY_SHADER_SHIFT) | ((uint64)texture << SPRITE_KEY_TEXTURE_SHIFT)
+         | ((uint64)blend << SPRITE_KEY_BLEND_SHIFT) | (uint64)(d * (float)SPRITE_KEY_DEPTH_MAX);
+}
+
+struct SpriteQuad
+{
+    Vector2     Min;
+    Vector2     Max;
+    Vector2     UvMin;
+    Vector2     UvMax;
+    uint32      Col;
+};
+
+struct SpriteBatchStats
+{
+    int     Quads;
+    int     DrawCallsUnbatched;     // State changes in submission order, what drawing as submitted would cost
+    int     DrawCalls;              // After sorting and merging
+    int     SortPasses;             // Radix passes that weren't skipped, out of 8
+};
+
+class SpriteBatch
+{
+public:
+    SpriteBatch() { memset(&Stats, 0, sizeof(Stats)); }
+
+    void begin() {
+        Keys.shrink(0);
+        Quads.shrink(0);
+    }
+
+    void add(uint64 key, const SpriteQuad& quad) {
+        Keys.push_back(key);
+        Quads.push_back(quad);
+    }
+
+    void add(int layer, uint32 shader, DrawTextureID texture, int blend, float depth, const SpriteQuad& quad) {
+        add(SpriteBatch_MakeKey(layer, shader, texture, blend, depth), quad);
+    }
+
+    // Sorts the quads and appends them to 'out', one DrawCmd per run of equal state.
+    void end(DrawList& out) {
+        const int count = Keys.size();
+        Stats.Quads = count;
+        Stats.DrawCallsUnbatched = count_runs(Keys.begin(), count);
+        sort();
+        Stats.DrawCalls = count_runs(Keys.begin(), count);
+
+        for (int start = 0; start < count; ) {
+            const uint64 state = Keys[start] & SPRITE_KEY_STATE_MASK;
+            int end = start + 1;
+            while (end < count && (Keys[end] & SPRITE_KEY_STATE_MASK) == state)
+                end++;
+
+            out.set_texture((DrawTextureID)((state >> SPRITE_KEY_TEXTURE_SHIFT) & SPRITE_KEY_TEXTURE_MAX));
+            out.set_state(SPRITE_STATE((state >> SPRITE_KEY_SHADER_SHIFT) & SPRITE_KEY_SHADER_MAX, (state >> SPRITE_KEY_BLEND_SHIFT) & SPRITE_KEY_BLEND_MAX));
+            out.prim_reserve((end - start) * 6, (end - start) * 4);
+            for (int i = start; i < end; i++) {
+                const SpriteQuad& quad = Quads[(int)Order[i]];
+                out.prim_rect_uv(quad.Min, quad.Max, quad.UvMin, quad.UvMax, quad.Col);
+            }
+            start = end;
+        }
+    }
+
+    const SpriteBatchStats& get_stats() const { return Stats; }
+
+private:
+    static int count_runs(const uint64* keys, int count) {
+        int runs = count ? 1 : 0;
+        for (int i = 1; i < count; i++)
+            runs += (keys[i] & SPRITE_KEY_STATE_MASK) != (keys[i - 1] & SPRITE_KEY_STATE_MASK) ? 1 : 0;
+        return runs;
+    }
+
+    // LSD radix sort of Keys, 8 bits per pass, stable: equal keys keep submission order.
+    // Order[i] is the quad the i-th sorted key belongs to. Passes where every key has the same byte are skipped.
+    void sort() {
+        const int count = Keys.size();
+        Order.resize_uninitialized(count);
+        for (int i = 0; i < count; i++)
+            Order[i] = (uint32)i;
+        Stats.SortPasses = 0;
+        if (count < 2)
+            return;
+
+        uint32 histograms[8][256];
+        memset(histograms, 0, sizeof(histograms));
+        for (int i = 0; i < count; i++) {
+            const uint64 key = Keys[i];
+            for (int pass = 0; pass < 8; pass++)
+                histograms[pass][(key >> (pass * 8)) & 0xFF]++;
+        }
+
+        TempKeys.resize_uninitialized(count);
+        TempOrder.resize_uninitialized(count);
+        for (int pass = 0; pass < 8; pass++) {
+            uint32* histogram = histograms[pass];
+            const int shift = pass * 8;
+            if (histogram[(Keys[0] >> shift) & 0xFF] == (uint32)count)
+                continue;
+            uint32 offset = 0;
+            for (int b = 0; b < 256; b++) {
+                const uint32 n = histogram[b];
+                histogram[b] = offset;
+                offset += n;
+            }
+            for (int i = 0; i < count; i++) {
+                const uint32 dst = histogram[(Keys[i] >> shift) & 0xFF]++;
+                TempKeys[(int)dst] = Keys[i];
+                TempOrder[(int)dst] = Order[i];
+            }
+            Keys.swap(TempKeys);
+            Order.swap(TempOrder);
+            Stats.SortPasses++;
+        }
+    }
+
+    TArray<uint64>      Keys;
+    TArray<SpriteQuad>  Quads;
+    TArray<uint32>      Order;
+    TArray<uint64>      TempKeys;
+    TArray<uint32>      TempOrder;
+    SpriteBatchStats    Stats;
+};
+
+// One render command per non-empty DrawCmd, the payload is the DrawCmd. Returns the number pushed.
+static inline int DrawList_Submit(const DrawList& list, RenderCommandBuffer& commands, RenderCommandFunc draw) {
+    int submitted = 0;
+    for (int i = 0; i < list.CmdBuffer.size(); i++) {
+        if (!list.CmdBuffer[i].ElemCount)
+            continue;
+        commands.push(draw, &list.CmdBuffer[i], (uint32)sizeof(DrawCmd));
+        submitted++;
+    }
+    return submitted;
+}
+
+#endif // SPRITE_BATCH_H
@@ -0,0 +1,307 @@
+//                        MIT License
+//
+//                  Copyright (c) 2024 Toby
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////
+/*                  StreamBuffer.h
+
+          Streams per frame vertex and index data
+          (DrawList, SpriteBatch) to the GPU without
+          glBufferData() copies and implicit syncs.
+
+          Persistent: the buffer is mapped once
+          (GL 4.4 buffer storage) and written in place.
+          It is a ring of STREAM_BUFFER_SEGMENTS
+          segments, each fenced at the end of the frames
+          that wrote it. Moving into a segment waits for
+          its fence, which only blocks when the GPU is
+          that many segments behind.
+
+          Orphaning (no buffer storage): allocations go
+          to a CPU staging copy, end_frame() orphans the
+          buffer and uploads what was written.
+
+          StreamBuffer vertices;
+          vertices.init(GetStreamBufferBackend(STREAM_BUFFER_BACKEND_GL), 8 << 20);
+          uint32 offset;
+          DrawVert* dst = vertices.alloc<DrawVert>(count, &offset);
+          ...
+          vertices.end_frame();    // After the frame's draws are issued
+
+          STREAM_BUFFER_BACKEND_CPU and _CPU_ORPHAN run
+          both paths on plain memory, no GPU needed.
+*/
+////////////////////////////////////////////////
+
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include "Variants.h"
+
+#include <string.h>     // memcpy, memset
+
+#define STREAM_BUFFER_SEGMENTS              3       // Frames in flight the ring allows
+
+#define STREAM_BUFFER_BACKEND_GL            0
+#define STREAM_BUFFER_BACKEND_CPU           1       // Persistent path on system memory, fences are always signaled
+#define STREAM_BUFFER_BACKEND_CPU_ORPHAN    2       // Orphaning path on system memory
+
+struct StreamBufferBackend
+{
+    const char*     Name;
+    // Returns the buffer. Sets 'mapped' when the storage stays mapped (persistent), null for the orphaning path.
+    void*           (*create)(uint32 size, void** mapped);
+    void            (*destroy)(void* buffer, void* mapped);
+    // Orphaning path: new storage for the buffer, then the frame's data.
+    void            (*upload)(void* buffer, uint32 capacity, const void* data, uint32 size);
+    void*           (*fence_insert)(void);
+    bool            (*fence_wait)(void* fence);     // True if it had to block
+    void            (*fence_delete)(void* fence);
+};
+
+struct StreamBufferStats
+{
+    uint64      Frames;
+    uint64      Allocations;
+    uint64      BytesWritten;
+    uint64      FencesWaited;       // Fences that weren't signaled yet: the CPU caught up with the GPU
+    uint64      SegmentsEntered;
+    uint64      FailedAllocations;  // The frame outgrew the buffer
+    uint32      FrameBytes;         // Last frame
+    uint32      PeakFrameBytes;
+};
+
+class StreamBuffer
+{
+public:
+    StreamBuffer() : Backend(nullptr), Buffer(nullptr), Mapped(nullptr), Staging(nullptr), Capacity(0), SegmentSize(0), Segment(0), Head(0), FrameStart(0), Touched(0) {
+        memset(SegmentFences, 0, sizeof(SegmentFences));
+        memset(&Stats, 0, sizeof(Stats));
+    }
+    ~StreamBuffer() { shutdown(); }
+
+    bool init(const StreamBufferBackend* backend, uint32 size) {
+        shutdown();
+        Backend = backend;
+        SegmentSize = size / STREAM_BUFFER_SEGMENTS;
+        Capacity = SegmentSize * STREAM_BUFFER_SEGMENTS;
+        Buffer = Backend->create(Capacity, &Mapped);
+        if (!Buffer)
+            return false;
+        if (!Mapped)
+            Staging = (uint8*)Memory_Alloc(Capacity, MEMORY_TAG_GENERAL);
+        Segment = 0;
+        Head = FrameStart = 0;
+        Touched = 0;
+        return true;
+    }
+
+    void shutdown() {
+        if (!Buffer)
+            return;
+        for (int i = 0; i < STREAM_BUFFER_SEGMENTS; i++) {
+            if (SegmentFences[i]) {
+                Backend->fence_wait(SegmentFences[i]);
+                Backend->fence_delete(SegmentFences[i]);
+                SegmentFences[i] = nullptr;
+            }
+        }
+        Backend->destroy(Buffer, Mapped);
+        Memory_Free(Staging);
+        Buffer = Mapped = nullptr;
+        Staging = nullptr;
+    }
+
+    // Room for 'size' bytes written this frame. 'out_offset' is where they are in the buffer, a multiple
+    // of 'align' (a vertex stride works, for base vertex draws). Null if the frame needs more than the buffer holds.
+    void* alloc(uint32 size, uint32 align, uint32* out_offset) {
+        assert(Buffer && align);
+        uint32 offset = (Head + align - 1) / align * align;
+        if (Mapped) {
+            if (offset + size > (Segment + 1) * SegmentSize) {
+                // Next segment, unless it still holds this frame's data
+                const int next = (Segment + 1) % STREAM_BUFFER_SEGMENTS;
+                if (Touched & (1u << next)) {
+                    Stats.FailedAllocations++;
+                    return nullptr;
+                }
+                enter_segment(next);
+                offset = (Head + align - 1) / align * align;
+                if (offset + size > (Segment + 1) * SegmentSize) {
+                    Stats.FailedAllocations++;
+                    return nullptr;
+                }
+            }
+            Touched |= 1u << Segment;
+        }
+        else if (offset + size > Capacity) {
+            Stats.FailedAllocations++;
+            return nullptr;
+        }
+        Head = offset + size;
+        *out_offset = offset;
+        Stats.Allocations++;
+        Stats.BytesWritten += size;
+        return (Mapped ? (uint8*)Mapped : Staging) + offset;
+    }
+
+    // Offset is a multiple of sizeof(T): out_offset / sizeof(T) is the base vertex.
+    template<typename T> T* alloc(int count, uint32* out_offset) { return (T*)alloc((uint32)(count * sizeof(T)), (uint32)sizeof(T), out_offset); }
+
+    // Call once the frame's draws reading the buffer have been issued.
+    void end_frame() {
+        uint32 frame_bytes;
+        if (Mapped) {
+            frame_bytes = Head >= FrameStart ? Head - FrameStart : Capacity - FrameStart + Head;
+            for (int i = 0; i < STREAM_BUFFER_SEGMENTS; i++) {
+                if (!(Touched & (1u << i)))
+                    continue;
+                // A newer fence covers everything the older one did
+                if (SegmentFences[i])
+                    Backend->fence_delete(SegmentFences[i]);
+                SegmentFences[i] = Backend->fence_insert();
+            }
+            Touched = 0;
+            FrameStart = Head;
+        }
+        else {
+            frame_bytes = Head;
+            if (Head)
+                Backend->upload(Buffer, Capacity, Staging, Head);
+            Head = 0;
+        }
+        Stats.Frames++;
+        Stats.FrameBytes = frame_bytes;
+        Stats.PeakFrameBytes = frame_bytes > Stats.PeakFrameBytes ? frame_bytes : Stats.PeakFrameBytes;
+    }
+
+    void*                       get_buffer() const      { return Buffer; }
+    bool                        is_persistent() const   { return Mapped != nullptr; }
+    uint32                      get_capacity() const    { return Capacity; }
+    const StreamBufferStats&    get_stats() const       { return Stats; }
+
+private:
+    void enter_segment(int segment) {
+        if (SegmentFences[segment]) {
+            Stats.FencesWaited += Backend->fence_wait(SegmentFences[segment]) ? 1 : 0;
+            Backend->fence_delete(SegmentFences[segment]);
+            SegmentFences[segment] = nullptr;
+        }
+        Segment = segment;
+        Head = segment * SegmentSize;
+        Stats.SegmentsEntered++;
+    }
+
+    const StreamBufferBackend*  Backend;
+    void*                       Buffer;
+    void*                       Mapped;         // Persistent path
+    uint8*                      Staging;        // Orphaning path
+    uint32                      Capacity;
+    uint32                      SegmentSize;
+    int                         Segment;        // Where Head is
+    uint32                      Head;
+    uint32                      FrameStart;
+    uint32                      Touched;        // Segments written this frame
+    void*                       SegmentFences[STREAM_BUFFER_SEGMENTS];
+    StreamBufferStats           Stats;
+};
+
+// CPU: the "GPU" is done the moment a fence is inserted.
+static inline void* StreamCPU_Create(uint32 size, void** mapped)                   { void* memory = Memory_Alloc(size, MEMORY_TAG_GENERAL); *mapped = memory; return memory; }
+static inline void* StreamCPU_CreateOrphan(uint32 size, void** mapped)             { *mapped = nullptr; return Memory_Alloc(size, MEMORY_TAG_GENERAL); }
+static inline void  StreamCPU_Destroy(void* buffer, void*)                         { Memory_Free(buffer); }
+static inline void  StreamCPU_Upload(void* buffer, uint32, const void* data, uint32 size) { memcpy(buffer, data, size); }
+static inline void* StreamCPU_FenceInsert(void)                                    { return (void*)1; }
+static inline bool  StreamCPU_FenceWait(void*)                                     { return false; }
+static inline void  StreamCPU_FenceDelete(void*)                                   {}
+
+#ifdef MOSS_STREAM_BUFFER_GL
+#include "thirdparty/glad/glad.h"
+
+static inline void* StreamGL_Create(uint32 size, void** mapped) {
+    GLuint buffer = 0;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    *mapped = nullptr;
+    if (GLAD_GL_VERSION_4_4 && glBufferStorage) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+        *mapped = glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+    }
+    else {
+        glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return (void*)(uintptr_t)buffer;
+}
+
+static inline void StreamGL_Destroy(void* buffer, void* mapped) {
+    GLuint name = (GLuint)(uintptr_t)buffer;
+    if (mapped) {
+        glBindBuffer(GL_ARRAY_BUFFER, name);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    glDeleteBuffers(1, &name);
+}
+
+// Orphaning: the driver hands out fresh storage, the old one lives until the GPU is done with it.
+static inline void StreamGL_Upload(void* buffer, uint32 capacity, const void* data, uint32 size) {
+    glBindBuffer(GL_ARRAY_BUFFER, (GLuint)(uintptr_t)buffer);
+    glBufferData(GL_ARRAY_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, size, data);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+static inline void* StreamGL_FenceInsert(void) { return glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0); }
+
+static inline bool StreamGL_FenceWait(void* fence) {
+    GLenum result = glClientWaitSync((GLsync)fence, 0, 0);
+    if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED)
+        return false;
+    while (result == GL_TIMEOUT_EXPIRED)
+        result = glClientWaitSync((GLsync)fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+    return true;
+}
+
+static inline void StreamGL_FenceDelete(void* fence) { glDeleteSync((GLsync)fence); }
+#endif // MOSS_STREAM_BUFFER_GL
+
+// GL needs MOSS_STREAM_BUFFER_GL (glad) and a current context, without the define it falls back to the CPU backend.
+static inline const StreamBufferBackend* GetStreamBufferBackend(int type) {
+    static const StreamBufferBackend cpu = {
+        "CPU", StreamCPU_Create, StreamCPU_Destroy, StreamCPU_Upload, StreamCPU_FenceInsert, StreamCPU_FenceWait, StreamCPU_FenceDelete
+    };
+    static const StreamBufferBackend cpu_orphan = {
+        "CPU orphan", StreamCPU_CreateOrphan, StreamCPU_Destroy, StreamCPU_Upload, StreamCPU_FenceInsert, StreamCPU_FenceWait, StreamCPU_FenceDelete
+    };
+#ifdef MOSS_STREAM_BUFFER_GL
+    static const StreamBufferBackend gl = {
+        "GL", StreamGL_Create, StreamGL_Destroy, StreamGL_Upload, StreamGL_FenceInsert, StreamGL_FenceWait, StreamGL_FenceDelete
+    };
+    if (type == STREAM_BUFFER_BACKEND_GL)
+        return &gl;
+#endif
+    return type == STREAM_BUFFER_BACKEND_CPU_ORPHAN ? &cpu_orphan : &cpu;
+}
+
+#endif // STREAM_BUFFER_H
@@ -0,0 +1,380 @@
+//                        MIT License
+//
+//                  Copyright (c) 2024 Toby
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////
+/*                  TextureAtlas.h
+
+          Packs small textures into shared pages at
+          load time, so sprites that used to bind one
+          texture each end up in the same draw call
+          (see SpriteBatch.h).
+
+          TextureAtlas atlas;
+          int sword = atlas.add_file("icons/sword.png");
+          atlas.add("glyph_a", pixels, 16, 16);
+          atlas.build();
+          // upload atlas.get_page(i).Pixels once per page
+          atlas.set_page_texture(i, gl_texture);
+          atlas.apply(sword, sword_texture);
+          Vector2 uv = atlas.remap_uv(entry, Vector2(0.0f, 1.0f));
+
+          apply() points a Texture2DDummy (internal.h)
+          at the page texture and the image's uv rect,
+          sprites drawing it need no change.
+
+          Skyline bottom-left packing, tallest images
+          first. Every image gets a border of copies of
+          its edge pixels (no bleeding with bilinear
+          filtering) and cells start on
+          TEXTURE_ATLAS_ALIGN pixel boundaries, so the
+          first mip levels never average two images.
+
+          Images larger than TEXTURE_ATLAS_MAX_IMAGE are
+          refused, they stay textures of their own.
+*/
+////////////////////////////////////////////////
+
+#ifndef TEXTURE_ATLAS_H
+#define TEXTURE_ATLAS_H
+
+#include "Variants.h"
+#include "Object.h"     // HashStr
+#include "thirdparty/stb/stb_image.h"
+
+#include <limits.h>     // INT_MAX
+#include <stdio.h>      // fprintf
+#include <stdlib.h>     // qsort
+#include <string.h>     // memcpy, memset, strcmp
+#include <chrono>
+
+#define TEXTURE_ATLAS_PAGE_SIZE     2048
+#define TEXTURE_ATLAS_MAX_IMAGE     256     // Width or height, larger ones aren't worth a page slot
+#define TEXTURE_ATLAS_PADDING       2       // Border pixels around every image, copies of its edge
+#define TEXTURE_ATLAS_ALIGN         4       // Cell origins and sizes, mip levels 1 and 2 stay inside a cell
+
+struct AtlasEntry
+{
+    uint32      Key;        // HashStr() of the name
+    int         NameOffset; // Into the atlas' name storage, see get_name()
+    int         Page;       // -1 until build()
+    int         X;          // Pixels of the image itself, without the border
+    int         Y;
+    int         Width;
+    int         Height;
+    Vector4     UvRect;     // u0, v0, u1, v1 in the page
+};
+
+struct AtlasPage
+{
+    int         Width;
+    int         Height;
+    uint8*      Pixels;     // RGBA8, MEMORY_TAG_TEXTURES
+    uint32      Texture;    // GL name once uploaded, see set_page_texture()
+    int         UsedArea;   // Image pixels, without borders and alignment
+};
+
+struct TextureAtlasStats
+{
+    int         Images;
+    int         Pages;
+    int         Refused;        // Too large or no room in an empty page
+    double      Efficiency;     // Image pixels over the page area up to the highest packed row
+    double      BuildMs;
+};
+
+class TextureAtlas
+{
+public:
+    explicit TextureAtlas(int page_size = TEXTURE_ATLAS_PAGE_SIZE) : PageSize(page_size) { memset(&Stats, 0, sizeof(Stats)); }
+    ~TextureAtlas() { clear(); }
+
+    // Copies 'rgba' until build(). Returns the entry, -1 if the image is too large for the atlas.
+    int add(const char* name, const uint8* rgba, int width, int height) {
+        if (width <= 0 || height <= 0 || width > TEXTURE_ATLAS_MAX_IMAGE || height > TEXTURE_ATLAS_MAX_IMAGE || cell_size(width) > PageSize || cell_size(height) > PageSize) {
+            Stats.Refused++;
+            return -1;
+        }
+        const int name_size = (int)strlen(name) + 1;
+        AtlasEntry entry;
+        entry.Key = HashStr(name);
+        entry.NameOffset = Names.size();
+        Names.resize_uninitialized(entry.NameOffset + name_size);
+        memcpy(&Names[entry.NameOffset], name, name_size);
+        entry.Page = -1;
+        entry.X = entry.Y = 0;
+        entry.Width = width;
+        entry.Height = height;
+        entry.UvRect = Vector4(0.0f, 0.0f, 1.0f, 1.0f);
+        Entries.push_back(entry);
+
+        PendingImage pending;
+        pending.Entry = Entries.size() - 1;
+        pending.Height = height;
+        pending.Pixels = (uint8*)Memory_Alloc((size_t)width * height * 4, MEMORY_TAG_TEXTURES);
+        memcpy(pending.Pixels, rgba, (size_t)width * height * 4);
+        Pending.push_back(pending);
+        return pending.Entry;
+    }
+
+    // Decoded with stb_image, always as RGBA8.
+    int add_file(const char* path) {
+        int width = 0, height = 0, channels = 0;
+        stbi_uc* pixels = stbi_load(path, &width, &height, &channels, 4);
+        if (!pixels) {
+            fprintf(stderr, "TextureAtlas: can't load '%s': %s\n", path, stbi_failure_reason());
+            return -1;
+        }
+        const int entry = add(path, pixels, width, height);
+        stbi_image_free(pixels);
+        return entry;
+    }
+
+    // Packs everything added since the last build() into the pages, opening new ones as needed.
+    bool build() {
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        // Tallest first keeps the skyline flat
+        qsort(Pending.begin(), Pending.size(), sizeof(PendingImage), &TextureAtlas::compare_height);
+        bool ok = true;
+        for (int i = 0; i < Pending.size(); i++) {
+            AtlasEntry& entry = Entries[Pending[i].Entry];
+            const int w = cell_size(entry.Width), h = cell_size(entry.Height);
+            int page = -1, x = 0, y = 0;
+            for (int p = 0; p < Pages.size() && page < 0; p++)
+                if (skyline_insert(p, w, h, x, y))
+                    page = p;
+            if (page < 0) {
+                add_page();
+                page = Pages.size() - 1;
+                if (!skyline_insert(page, w, h, x, y)) {
+                    Stats.Refused++;
+                    ok = false;
+                    continue;
+                }
+            }
+            entry.Page = page;
+            entry.X = x + TEXTURE_ATLAS_PADDING;
+            entry.Y = y + TEXTURE_ATLAS_PADDING;
+            const float inv_w = 1.0f / (float)Pages[page].Width, inv_h = 1.0f / (float)Pages[page].Height;
+            entry.UvRect = Vector4(entry.X * inv_w, entry.Y * inv_h, (entry.X + entry.Width) * inv_w, (entry.Y + entry.Height) * inv_h);
+            blit(Pages[page], entry, Pending[i].Pixels);
+            Pages[page].UsedArea += entry.Width * entry.Height;
+            Stats.Images++;
+        }
+        for (int i = 0; i < Pending.size(); i++)
+            Memory_Free(Pending[i].Pixels);
+        Pending.shrink(0);
+
+        double used = 0.0, total = 0.0;
+        for (int p = 0; p < Pages.size(); p++) {
+            int top = 0;
+            for (int i = 0; i < Skylines[p].size(); i++)
+                top = Max(top, Skylines[p][i].Y);
+            used += Pages[p].UsedArea;
+            total += (double)Pages[p].Width * top;
+        }
+        Stats.Pages = Pages.size();
+        Stats.Efficiency = total > 0.0 ? used / total : 0.0;
+        Stats.BuildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return ok;
+    }
+
+    // -1 if it isn't in the atlas. The key skips most entries, the name confirms a match.
+    int find(const char* name) const {
+        const uint32 key = HashStr(name);
+        for (int i = 0; i < Entries.size(); i++)
+            if (Entries[i].Key == key && strcmp(&Names[Entries[i].NameOffset], name) == 0)
+                return i;
+        return -1;
+    }
+
+    // The page's pixels were uploaded as 'texture'.
+    void set_page_texture(int page, uint32 texture) { Pages[page].Texture = texture; }
+
+    // Points a Texture2DDummy at the packed image: 'id' becomes the page's texture and 'uv_rect'
+    // the image's rect in it. False and untouched until the entry is packed and its page uploaded.
+    // A template so this header doesn't pull in internal.h.
+    template<typename Texture>
+    bool apply(int entry, Texture& texture) const {
+        const AtlasEntry& e = Entries[entry];
+        if (e.Page < 0 || !Pages[e.Page].Texture)
+            return false;
+        texture.id = Pages[e.Page].Texture;
+        texture.uv_rect = e.UvRect;
+        return true;
+    }
+
+    // The image's own 0..1 uv to the page's.
+    Vector2 remap_uv(int entry, const Vector2& uv) const {
+        const Vector4& r = Entries[entry].UvRect;
+        return Vector2(r.x + (r.z - r.x) * uv.x, r.y + (r.w - r.y) * uv.y);
+    }
+
+    const AtlasEntry&           get_entry(int entry) const  { return Entries[entry]; }
+    const char*                 get_name(int entry) const   { return &Names[Entries[entry].NameOffset]; }
+    int                         get_entry_count() const     { return Entries.size(); }
+    const AtlasPage&            get_page(int page) const    { return Pages[page]; }
+    int                         get_page_count() const      { return Pages.size(); }
+    const TextureAtlasStats&    get_stats() const           { return Stats; }
+
+    void clear() {
+        for (int i = 0; i < Pending.size(); i++)
+            Memory_Free(Pending[i].Pixels);
+        for (int p = 0; p < Pages.size(); p++)
+            Memory_Free(Pages[p].Pixels);
+        Pending.clear();
+        Pages.clear();
+        Skylines.clear();
+        Entries.clear();
+        Names.clear();
+        memset(&Stats, 0, sizeof(Stats));
+    }
+
+private:
+    struct PendingImage
+    {
+        int         Entry;
+        int         Height;
+        uint8*      Pixels;
+    };
+
+    // Top edge of the packed area: [X, X + Width) is filled up to Y.
+    struct SkylineNode
+    {
+        int         X;
+        int         Y;
+        int         Width;
+    };
+
+    static int cell_size(int size) {
+        const int padded = size + TEXTURE_ATLAS_PADDING * 2;
+        return (padded + TEXTURE_ATLAS_ALIGN - 1) & ~(TEXTURE_ATLAS_ALIGN - 1);
+    }
+
+    static int compare_height(const void* a, const void* b) {
+        const PendingImage* pa = (const PendingImage*)a;
+        const PendingImage* pb = (const PendingImage*)b;
+        return pa->Height != pb->Height ? pb->Height - pa->Height : pa->Entry - pb->Entry;
+    }
+
+    void add_page() {
+        AtlasPage page;
+        page.Width = PageSize;
+        page.Height = PageSize;
+        page.Pixels = (uint8*)Memory_Alloc((size_t)PageSize * PageSize * 4, MEMORY_TAG_TEXTURES);
+        memset(page.Pixels, 0, (size_t)PageSize * PageSize * 4);
+        page.UsedArea = 0;
+        page.Texture = 0;
+        Pages.push_back(page);
+        Skylines.resize(Pages.size());
+        SkylineNode node = { 0, 0, PageSize };
+        Skylines.back().push_back(node);
+    }
+
+    // Lowest top edge for a w wide cell starting at node 'index', -1 if it doesn't fit.
+    int skyline_fit(const TArray<SkylineNode>& nodes, int index, int w, int h, int height) const {
+        const int x = nodes[index].X;
+        if (x + w > PageSize)
+            return -1;
+        int y = 0;
+        for (int i = index, left = w; left > 0; i++) {
+            y = Max(y, nodes[i].Y);
+            if (y + h > height)
+                return -1;
+            left -= nodes[i].Width;
+        }
+        return y;
+    }
+
+    // Bottom-left: the position with the lowest top, then the narrowest node.
+    bool skyline_insert(int page, int w, int h, int& out_x, int& out_y) {
+        TArray<SkylineNode>& nodes = Skylines[page];
+        int best = -1, best_top = INT_MAX, best_width = INT_MAX;
+        for (int i = 0; i < nodes.size(); i++) {
+            const int y = skyline_fit(nodes, i, w, h, Pages[page].Height);
+            if (y < 0)
+                continue;
+            if (y + h < best_top || (y + h == best_top && nodes[i].Width < best_width)) {
+                best = i;
+                best_top = y + h;
+                best_width = nodes[i].Width;
+            }
+        }
+        if (best < 0)
+            return false;
+
+        out_x = nodes[best].X;
+        out_y = best_top - h;
+        SkylineNode node = { out_x, best_top, w };
+        nodes.insert(nodes.begin() + best, node);
+
+        // Cut the nodes now under the new one
+        for (int i = best + 1; i < nodes.size(); ) {
+            const int covered = nodes[i - 1].X + nodes[i - 1].Width - nodes[i].X;
+            if (covered <= 0)
+                break;
+            if (covered >= nodes[i].Width) {
+                nodes.erase(nodes.begin() + i);
+                continue;
+            }
+            nodes[i].X += covered;
+            nodes[i].Width -= covered;
+            break;
+        }
+        // Merge neighbours at the same height
+        for (int i = 0; i + 1 < nodes.size(); ) {
+            if (nodes[i].Y == nodes[i + 1].Y) {
+                nodes[i].Width += nodes[i + 1].Width;
+                nodes.erase(nodes.begin() + i + 1);
+            }
+            else {
+                i++;
+            }
+        }
+        return true;
+    }
+
+    // Copies the image and extrudes its edges into the border.
+    static void blit(AtlasPage& page, const AtlasEntry& entry, const uint8* src) {
+        const int pad = TEXTURE_ATLAS_PADDING;
+        for (int y = -pad; y < entry.Height + pad; y++) {
+            const int sy = Clamp(y, 0, entry.Height - 1);
+            uint32* dst = (uint32*)page.Pixels + (size_t)(entry.Y + y) * page.Width + entry.X;
+            const uint32* row = (const uint32*)src + (size_t)sy * entry.Width;
+            memcpy(dst, row, (size_t)entry.Width * 4);
+            for (int x = 1; x <= pad; x++) {
+                dst[-x] = row[0];
+                dst[entry.Width - 1 + x] = row[entry.Width - 1];
+            }
+        }
+    }
+
+    int                             PageSize;
+    TArray<AtlasEntry>              Entries;
+    TArray<char>                    Names;      // Every entry's name, NUL terminated
+    TArray<AtlasPage>               Pages;
+    TArray<TArray<SkylineNode> >    Skylines;   // One per page
+    TArray<PendingImage>            Pending;
+    TextureAtlasStats               Stats;
+};
+
+#endif // TEXTURE_ATLAS_H
@@ -32,6 +32,13 @@
 #define VARIANTS_H
 
 #include "Math.h"
+#include "Memory.h"
+
+#include <atomic>           // Variant ref counts
+#include <limits.h>         // INT_MIN, LLONG_MIN
+#include <new>              // placement new
+#include <string.h>         // memcpy, memset, memcmp
+#include <type_traits>      // std::is_trivially_destructible
 
 // Add these v
 typedef struct Basis;
@@ -95,17 +102,19 @@ static inline Vector4 Max(const Vector4& lhs, const Vector4& rhs) { return Vecto
 static inline Vector4 Clamp(const Vector4& v, const Vector4& mn, const Vector4& mx) { return Vector4((v.x < mn.x) ? mn.x : (v.x > mx.x) ? mx.x : v.x, (v.y < mn.y) ? mn.y : (v.y > mx.y) ? mx.y : v.y, (v.z < mn.z) ? mn.z : (v.z > mx.z) ? mx.z : v.z,(v.w < mn.w) ? mn.w : (v.w > mx.w) ? mx.w : v.w); }
 
 
-struct Variant;
+struct Variant;   // Tagged union of all the value types below, defined at the end of this file
 struct Object;
+struct PropertyHandle;   // Object.h
 
-struct Tween : public Variant
+struct Tween
 {
     // Constructor
     Tween() : elapsedTime(0.0f), duration(0.0f), playing(false), currentValue(0.0f) {}
     Tween tween_callback(Callable callback);
     Tween tween_interval(float time);
     Tween tween_method(Callable method, Variant from, Variant to, float duration);
-    Tween tween_property(Object: object, NodePath property, Variant final_val, float duration);
+    Tween tween_property(Object* object, const char* property, Variant final_val, float duration);             // Resolves the property once, on creation
+    Tween tween_property(Object* object, const PropertyHandle& property, Variant final_val, float duration);
 
     //bind_node(node: Node);
 
@@ -148,7 +157,7 @@ struct Tween : public Variant
     void stop();
 };
 
-struct Vector2 : public Variant
+struct Vector2
 {
     float x, y;
 
@@ -263,7 +272,7 @@ inline Vector2 operator-(float scalar, const Vector2& vector) { return Vector2(s
 inline Vector2 operator*(float scalar, const Vector2& vector) { return Vector2(scalar * vector.x, scalar * vector.y); }
 inline Vector2 operator/(float scalar, const Vector2& vector) { return Vector2(scalar / vector.x, scalar / vector.y); }
 
-struct Vector2i : public Variant
+struct Vector2i
 {
     int x, y;
 
@@ -312,7 +321,7 @@ inline Vector2i operator*(int scalar, const Vector2i& vector) { return Vector2i(
 inline Vector2i operator/(int scalar, const Vector2i& vector) { return Vector2i(scalar / vector.x, scalar / vector.y); }
 inline Vector2i operator%(int scalar, const Vector2i& vector) { return Vector2i(scalar % vector.x, scalar % vector.y); }
 
-struct Vector3 : public Variant
+struct Vector3
 {
     float x, y, z;
 
@@ -391,7 +400,7 @@ inline Vector3 operator-(float scalar, const Vector3& vector) { return Vector3(s
 inline Vector3 operator*(float scalar, const Vector3& vector) { return Vector3(scalar * vector.x, scalar * vector.y, scalar * vector.z); }
 inline Vector3 operator/(float scalar, const Vector3& vector) { return Vector3(scalar / vector.x, scalar / vector.y, scalar / vector.z); }
 
-struct Vector3i : public Variant
+struct Vector3i
 {
     int x, y, z;
 
@@ -441,7 +450,7 @@ inline Vector3i operator*(int scalar, const Vector3i& vector) { return Vector3i(
 inline Vector3i operator/(int scalar, const Vector3i& vector) { return Vector3i(scalar / vector.x, scalar / vector.y, scalar / vector.z); }
 inline Vector3i operator%(int scalar, const Vector3i& vector) { return Vector3i(scalar % vector.x, scalar % vector.y, scalar % vector.z); }
 
-struct Vector4 : public Variant
+struct Vector4
 {
     float x, y, z, w;
 
@@ -492,7 +501,7 @@ inline Vector4 operator-(float scalar, const Vector4& vector) { return Vector4(s
 inline Vector4 operator*(float scalar, const Vector4& vector) { return Vector4(scalar * vector.x, scalar * vector.y, scalar * vector.z, scalar * vector.w); }
 inline Vector4 operator/(float scalar, const Vector4& vector) { return Vector4(scalar / vector.x, scalar / vector.y, scalar / vector.z, scalar / vector.w); }
 
-struct Vector4i : public Variant
+struct Vector4i
 {
     int x, y, z, w;
 
@@ -544,7 +553,7 @@ inline Vector4i operator/(int scalar, const Vector4i& vector) { return Vector4i(
 inline Vector4i operator%(int scalar, const Vector4i& vector) { return Vector4i(scalar % vector.x, scalar % vector.y, scalar % vector.z, scalar % vector.w); }
 
 template<typename KeyType, typename ValueType>
-class TMap : public Variant{
+class TMap {
 public:
     // Add a key-value pair to the dictionary
     void add(const KeyType& key, const ValueType& value) {
@@ -576,6 +585,10 @@ public:
         return dict.find(key) != dict.end();
     }
 
+    int size() const {
+        return (int)dict.size();
+    }
+
     // Print all key-value pairs
     void print() const {
         for (const auto& pair : dict) {
@@ -587,27 +600,27 @@ private:
     std::unordered_map<KeyType, ValueType> dict;
 };
 
-template<typename T>
-class TArray : public Variant
+template<typename T, typename Allocator = HeapAllocator>
+class TArray
 {
 public:
     typedef T value_type;
     typedef value_type* iterator;
     typedef const value_type* const_iterator;
 
-    Vector() : Size(0), Capacity(0), Data(nullptr) {}
+    TArray() : Size(0), Capacity(0), Data(nullptr) {}
 
-    Vector(const Vector<T>& src) : Size(0), Capacity(0), Data(nullptr) {
+    TArray(const TArray& src) : Size(0), Capacity(0), Data(nullptr) {
         operator=(src);
     }
 
-    Vector(Vector<T>&& src) noexcept : Size(src.Size), Capacity(src.Capacity), Data(src.Data) {
+    TArray(TArray&& src) noexcept : Size(src.Size), Capacity(src.Capacity), Data(src.Data) {
         src.Size = 0;
         src.Capacity = 0;
         src.Data = nullptr;
     }
 
-    Vector<T>& operator=(const Vector<T>& src) {
+    TArray& operator=(const TArray& src) {
         if (this != &src) {
             clear();
             resize(src.Size);
@@ -620,7 +633,7 @@ public:
         return *this;
     }
 
-    Vector<T>& operator=(Vector<T>&& src) noexcept {
+    TArray& operator=(TArray&& src) noexcept {
         if (this != &src) {
             clear();
             Size = src.Size;
@@ -633,7 +646,7 @@ public:
         return *this;
     }
 
-    ~Vector() {
+    ~TArray() {
         clear();
     }
 
@@ -642,7 +655,7 @@ public:
             for (int i = 0; i < Size; ++i) {
                 Data[i].~T();
             }
-            free(Data);
+            Allocator::free(Data);
             Data = nullptr;
             Size = Capacity = 0;
         }
@@ -714,7 +727,7 @@ public:
         return Data[Size - 1];
     }
 
-    void swap(Vector<T>& rhs) {
+    void swap(TArray& rhs) {
         T* tmp_data = rhs.Data;
         rhs.Data = Data;
         Data = tmp_data;
@@ -762,16 +775,25 @@ public:
         Size = new_size;
     }
 
+    // Grows without constructing, for buffers of plain data the caller writes right after (vertices, indices).
+    void resize_uninitialized(int new_size) {
+        static_assert(std::is_trivially_destructible<T>::value, "resize_uninitialized() skips constructors and destructors");
+        if (new_size > Capacity) {
+            reserve(_grow_capacity(new_size));
+        }
+        Size = new_size;
+    }
+
     /**/
     void reserve(int new_capacity) {
         if (new_capacity <= Capacity) return;
-        T* new_data = (T*)malloc(new_capacity * sizeof(T));
+        T* new_data = (T*)Allocator::alloc(new_capacity * sizeof(T));
         if (Data) {
             for (int i = 0; i < Size; ++i) {
                 new(&new_data[i]) T(std::move(Data[i]));
                 Data[i].~T();
             }
-            free(Data);
+            Allocator::free(Data);
         }
         Data = new_data;
         Capacity = new_capacity;
@@ -780,9 +802,9 @@ public:
     void reserve_discard(int new_capacity) {
         if (new_capacity <= Capacity) return;
         if (Data) {
-            free(Data);
+            Allocator::free(Data);
         }
-        Data = (T*)malloc(new_capacity * sizeof(T));
+        Data = (T*)Allocator::alloc(new_capacity * sizeof(T));
         Capacity = new_capacity;
     }
 
@@ -922,7 +944,10 @@ private:
     T* Data;
 };
 
-struct Rect : public Variant
+// Per frame scratch array, see FrameAllocator. Don't keep it past FRAME_ALLOCATOR_BUFFER_COUNT frames.
+template<typename T> using FrameArray = TArray<T, FrameHeap>;
+
+struct Rect
 {
     //float x, y, w, h;
     Vector2      min;    // Upper-left
@@ -960,7 +985,7 @@ struct Rect : public Variant
     Vector4 ToVec4() const                      { return Vector4(min.x, min.y, max.x, max.y); }
 };
 
-struct Recti : public Variant
+struct Recti
 {
     //int x, y, w, h;
     Vector2i      min;    // Upper-left
@@ -998,7 +1023,7 @@ struct Recti : public Variant
     Vector4i ToVec4() const                     { return Vector4i(min.x, min.y, max.x, max.y); }
 };
 
-struct Color : public Variant
+struct Color
 {
     float r, g, b, a;
 
@@ -1044,32 +1069,8 @@ struct Color : public Variant
     static Color MAGENTA()  { return Color(1.0f, 0.0f, 1.0f); }
 
 
-    void toHSV(float& h, float& s, float& v) const {
-        float max = std::max({ r, g, b });
-        float min = std::min({ r, g, b });
-        v = max;
-
-        float delta = max - min;
-        if (max == 0) {
-            s = 0;
-            h = 0;
-            return;
-        }
-
-        s = delta / max;
-
-        if (r == max) {
-            h = (g - b) / delta + (g < b ? 6 : 0);
-        }
-        else if (g == max) {
-            h = (b - r) / delta + 2;
-        }
-        else {
-            h = (r - g) / delta + 4;
-        }
-
-        h /= 6;
-    }
+    // Branchless, see ColorConvertRGBtoHSVFast() below.
+    void toHSV(float& h, float& s, float& v) const;
 
     void toRGB(float h, float s, float v) {
         int i = static_cast<int>(h * 6);
@@ -1095,8 +1096,186 @@ struct Color : public Variant
     void          ColorConvertRGBtoHSV(float r, float g, float b, float& out_h, float& out_s, float& out_v);
     void          ColorConvertHSVtoRGB(float h, float s, float v, float& out_r, float& out_g, float& out_b);
 
+// - sRGB <-> linear
+// Exact (powf) versions are used for single values, the tables are for whole images.
+static inline float  ColorSRGBToLinear(float c)   { return (c <= 0.04045f) ? c * (1.0f / 12.92f) : powf((c + 0.055f) * (1.0f / 1.055f), 2.4f); }
+static inline float  ColorLinearToSRGB(float c)   { return (c <= 0.0031308f) ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f; }
+
+#define COLOR_SRGB8_LINEAR_STEPS 4096   // Resolution of the linear -> sRGB8 table, result is within one 8-bit step of the exact value
+
+struct ColorSRGB8Tables
+{
+    float   SRGB8ToLinear[256];
+    uint8   LinearToSRGB8[COLOR_SRGB8_LINEAR_STEPS];
+
+    ColorSRGB8Tables() {
+        for (int i = 0; i < 256; i++)
+            SRGB8ToLinear[i] = ColorSRGBToLinear((float)i * (1.0f / 255.0f));
+        for (int i = 0; i < COLOR_SRGB8_LINEAR_STEPS; i++)
+            LinearToSRGB8[i] = (uint8)(ColorLinearToSRGB((float)i / (float)(COLOR_SRGB8_LINEAR_STEPS - 1)) * 255.0f + 0.5f);
+    }
+};
 
-struct Curve : public Variant{
+// 16-bit tables are 256 KB, kept separate so 8-bit users never build them.
+struct ColorSRGB16Tables
+{
+    uint16  SRGB16ToLinear16[65536];
+    uint16  Linear16ToSRGB16[65536];
+
+    ColorSRGB16Tables() {
+        for (int i = 0; i < 65536; i++) {
+            SRGB16ToLinear16[i] = (uint16)(ColorSRGBToLinear((float)i * (1.0f / 65535.0f)) * 65535.0f + 0.5f);
+            Linear16ToSRGB16[i] = (uint16)(ColorLinearToSRGB((float)i * (1.0f / 65535.0f)) * 65535.0f + 0.5f);
+        }
+    }
+};
+
+// Built on first use (thread-safe function local static), shared by every translation unit.
+inline const ColorSRGB8Tables&  GetColorSRGB8Tables()  { static ColorSRGB8Tables tables; return tables; }
+inline const ColorSRGB16Tables& GetColorSRGB16Tables() { static ColorSRGB16Tables* tables = new ColorSRGB16Tables(); return *tables; }
+
+static inline float  ColorConvertSRGB8ToLinear(uint8 c)         { return GetColorSRGB8Tables().SRGB8ToLinear[c]; }
+static inline uint8  ColorConvertLinearToSRGB8(float c)         { return GetColorSRGB8Tables().LinearToSRGB8[(int)(Saturate(c) * (float)(COLOR_SRGB8_LINEAR_STEPS - 1) + 0.5f)]; }
+static inline uint16 ColorConvertSRGB16ToLinear16(uint16 c)     { return GetColorSRGB16Tables().SRGB16ToLinear16[c]; }
+static inline uint16 ColorConvertLinear16ToSRGB16(uint16 c)     { return GetColorSRGB16Tables().Linear16ToSRGB16[c]; }
+
+// COL32 (sRGB) -> linear Color. Alpha is never gamma encoded and is only rescaled.
+static inline void ColorConvertSRGB8ToLinearBatch(const uint32* in, Color* out, int count)
+{
+    const float* lut = GetColorSRGB8Tables().SRGB8ToLinear;
+    for (int i = 0; i < count; i++) {
+        const uint32 c = in[i];
+        out[i].r = lut[(c >> COL32_R_SHIFT) & 0xFF];
+        out[i].g = lut[(c >> COL32_G_SHIFT) & 0xFF];
+        out[i].b = lut[(c >> COL32_B_SHIFT) & 0xFF];
+        out[i].a = (float)((c >> COL32_A_SHIFT) & 0xFF) * (1.0f / 255.0f);
+    }
+}
+
+// Linear Color -> COL32 (sRGB).
+static inline void ColorConvertLinearToSRGB8Batch(const Color* in, uint32* out, int count)
+{
+    const uint8* lut = GetColorSRGB8Tables().LinearToSRGB8;
+    const float scale = (float)(COLOR_SRGB8_LINEAR_STEPS - 1);
+    for (int i = 0; i < count; i++) {
+        const uint32 r = lut[(int)(Saturate(in[i].r) * scale + 0.5f)];
+        const uint32 g = lut[(int)(Saturate(in[i].g) * scale + 0.5f)];
+        const uint32 b = lut[(int)(Saturate(in[i].b) * scale + 0.5f)];
+        const uint32 a = (uint32)(Saturate(in[i].a) * 255.0f + 0.5f);
+        out[i] = COL32(r, g, b, a);
+    }
+}
+
+// 16-bit channels, works on any channel layout since every channel is handled the same.
+// Skip the alpha channel yourself (e.g. convert RGB planes only).
+static inline void ColorConvertSRGB16ToLinear16Batch(const uint16* in, uint16* out, int count)
+{
+    const uint16* lut = GetColorSRGB16Tables().SRGB16ToLinear16;
+    for (int i = 0; i < count; i++)
+        out[i] = lut[in[i]];
+}
+
+static inline void ColorConvertLinear16ToSRGB16Batch(const uint16* in, uint16* out, int count)
+{
+    const uint16* lut = GetColorSRGB16Tables().Linear16ToSRGB16;
+    for (int i = 0; i < count; i++)
+        out[i] = lut[in[i]];
+}
+
+// - HSV / HSL
+// Branchless versions: every compare is a select so the batch loops below auto-vectorize.
+// Hue, saturation and value/lightness are all in the 0..1 range.
+static inline void ColorConvertRGBtoHSVFast(float r, float g, float b, float& out_h, float& out_s, float& out_v)
+{
+    const bool  gb = g < b;
+    const float g1 = gb ? b : g;
+    const float b1 = gb ? g : b;
+    float       k  = gb ? -1.0f : 0.0f;
+
+    const bool  rg = r < g1;
+    const float r2 = rg ? g1 : r;
+    const float g2 = rg ? r : g1;
+    k = rg ? (-2.0f / 6.0f - k) : k;
+
+    const float chroma = r2 - (g2 < b1 ? g2 : b1);
+    out_h = Fabs(k + (g2 - b1) / (6.0f * chroma + 1e-20f));
+    out_s = chroma / (r2 + 1e-20f);
+    out_v = r2;
+}
+
+// Returns 0..1, how much of channel k (1, 2/3, 1/3 for r, g, b) hue h contributes.
+static inline float ColorHueChannel(float h, float k)
+{
+    float x = h + k;
+    x -= (float)(int)x;
+    return Saturate(Fabs(x * 6.0f - 3.0f) - 1.0f);
+}
+
+static inline void ColorConvertHSVtoRGBFast(float h, float s, float v, float& out_r, float& out_g, float& out_b)
+{
+    out_r = v * (1.0f - s + s * ColorHueChannel(h, 1.0f));
+    out_g = v * (1.0f - s + s * ColorHueChannel(h, 2.0f / 3.0f));
+    out_b = v * (1.0f - s + s * ColorHueChannel(h, 1.0f / 3.0f));
+}
+
+static inline void ColorConvertRGBtoHSLFast(float r, float g, float b, float& out_h, float& out_s, float& out_l)
+{
+    float s, v;
+    ColorConvertRGBtoHSVFast(r, g, b, out_h, s, v);
+    const float chroma = s * v;
+    out_l = v - chroma * 0.5f;
+    out_s = chroma / (1.0f - Fabs(2.0f * out_l - 1.0f) + 1e-20f);
+}
+
+static inline void ColorConvertHSLtoRGBFast(float h, float s, float l, float& out_r, float& out_g, float& out_b)
+{
+    const float chroma = (1.0f - Fabs(2.0f * l - 1.0f)) * s;
+    out_r = l + chroma * (ColorHueChannel(h, 1.0f) - 0.5f);
+    out_g = l + chroma * (ColorHueChannel(h, 2.0f / 3.0f) - 0.5f);
+    out_b = l + chroma * (ColorHueChannel(h, 1.0f / 3.0f) - 0.5f);
+}
+
+// Batch converters. HSV/HSL are stored in r/g/b of the output, alpha is copied. 'in' and 'out' may alias.
+static inline void ColorConvertRGBtoHSVBatch(const Color* in, Color* out, int count)
+{
+    for (int i = 0; i < count; i++) {
+        const Color c = in[i];
+        ColorConvertRGBtoHSVFast(c.r, c.g, c.b, out[i].r, out[i].g, out[i].b);
+        out[i].a = c.a;
+    }
+}
+
+static inline void ColorConvertHSVtoRGBBatch(const Color* in, Color* out, int count)
+{
+    for (int i = 0; i < count; i++) {
+        const Color c = in[i];
+        ColorConvertHSVtoRGBFast(c.r, c.g, c.b, out[i].r, out[i].g, out[i].b);
+        out[i].a = c.a;
+    }
+}
+
+static inline void ColorConvertRGBtoHSLBatch(const Color* in, Color* out, int count)
+{
+    for (int i = 0; i < count; i++) {
+        const Color c = in[i];
+        ColorConvertRGBtoHSLFast(c.r, c.g, c.b, out[i].r, out[i].g, out[i].b);
+        out[i].a = c.a;
+    }
+}
+
+static inline void ColorConvertHSLtoRGBBatch(const Color* in, Color* out, int count)
+{
+    for (int i = 0; i < count; i++) {
+        const Color c = in[i];
+        ColorConvertHSLtoRGBFast(c.r, c.g, c.b, out[i].r, out[i].g, out[i].b);
+        out[i].a = c.a;
+    }
+}
+
+inline void Color::toHSV(float& h, float& s, float& v) const { ColorConvertRGBtoHSVFast(r, g, b, h, s, v); }
+
+
+struct Curve {
     TArray<Vector2> values;
 
     static const int MIN_X = 0.f;
@@ -1181,7 +1360,7 @@ struct Curve : public Variant{
     void set_point_value(int index, float y) {}
 };
 
-struct Curve2D : public Variant
+struct Curve2D
 {
     // Add a point to the curve
     void add_point(const Vector2& point) {
@@ -1249,7 +1428,7 @@ struct Curve2D : public Variant
     int m_pointCount;
 };
 
-struct Curve3D : public Variant
+struct Curve3D
 {
     // Add a point to the curve
     void add_point(const Vector3& point) {
@@ -1328,19 +1507,127 @@ struct Curve3D : public Variant
     bool up_vector_enabled;
 };
 
-struct AABB2 : public Variant
+#define GRADIENT_INTERPOLATE_LINEAR         0
+#define GRADIENT_INTERPOLATE_CONSTANT       1
+
+#define GRADIENT_COLOR_SPACE_SRGB           0   // Blend the stored (sRGB encoded) values directly
+#define GRADIENT_COLOR_SPACE_LINEAR_SRGB    1   // Decode, blend in linear light, encode again. No dark bands between saturated stops.
+
+struct Gradiant
+{
+    TArray<float> offsets;      // Sorted, 0..1
+    TArray<Color> colors;       // sRGB encoded, one per offset
+    int interpolation_mode = GRADIENT_INTERPOLATE_LINEAR;
+    int interpolation_color_space = GRADIENT_COLOR_SPACE_SRGB;
+
+    // Keeps offsets sorted
+    void add_point(float offset, const Color& color) {
+        int i = 0;
+        while (i < offsets.size() && offsets[i] <= offset)
+            i++;
+        offsets.insert(offsets.begin() + i, offset);
+        colors.insert(colors.begin() + i, color);
+    }
+
+    void remove_point(int index) {
+        offsets.erase(offsets.begin() + index);
+        colors.erase(colors.begin() + index);
+    }
+
+    int get_point_count() const { return offsets.size(); }
+
+    Color sample(float offset) const {
+        const int count = offsets.size();
+        if (count == 0)
+            return Color(0.0f, 0.0f, 0.0f, 1.0f);
+        if (offset <= offsets[0])
+            return colors[0];
+        if (offset >= offsets[count - 1])
+            return colors[count - 1];
+
+        int i = 1;
+        while (offsets[i] < offset)
+            i++;
+        if (interpolation_mode == GRADIENT_INTERPOLATE_CONSTANT)
+            return colors[i - 1];
+
+        const float t = (offset - offsets[i - 1]) / (offsets[i] - offsets[i - 1]);
+        return blend(colors[i - 1], colors[i], t);
+    }
+
+    // Bakes 'count' evenly spaced samples into COL32 values (e.g. a 256 wide ramp texture).
+    // Stops are decoded once and the segments are walked in order, no per sample search.
+    void bake(uint32* out, int count) const {
+        const int point_count = offsets.size();
+        if (point_count == 0 || count <= 0) {
+            for (int i = 0; i < count; i++)
+                out[i] = COL32_BLACK;
+            return;
+        }
+
+        const bool linear = interpolation_color_space == GRADIENT_COLOR_SPACE_LINEAR_SRGB;
+        TArray<Color> stops;
+        stops.resize(point_count);
+        for (int i = 0; i < point_count; i++)
+            stops[i] = linear ? to_linear(colors[i]) : colors[i];
+
+        int seg = 1;
+        const float step = count > 1 ? 1.0f / (float)(count - 1) : 0.0f;
+        for (int i = 0; i < count; i++) {
+            const float offset = (float)i * step;
+            Color c;
+            if (point_count == 1 || offset <= offsets[0])
+                c = stops[0];
+            else if (offset >= offsets[point_count - 1])
+                c = stops[point_count - 1];
+            else {
+                while (offsets[seg] < offset)
+                    seg++;
+                if (interpolation_mode == GRADIENT_INTERPOLATE_CONSTANT)
+                    c = stops[seg - 1];
+                else {
+                    const float t = (offset - offsets[seg - 1]) / (offsets[seg] - offsets[seg - 1]);
+                    const Color& a = stops[seg - 1];
+                    const Color& b = stops[seg];
+                    c = Color(a.r + (b.r - a.r) * t, a.g + (b.g - a.g) * t, a.b + (b.b - a.b) * t, a.a + (b.a - a.a) * t);
+                }
+            }
+            out[i] = linear ? pack_linear(c) : ColorConvertFloat4ToU32(c);
+        }
+    }
+
+private:
+    static Color to_linear(const Color& c)  { return Color(ColorSRGBToLinear(c.r), ColorSRGBToLinear(c.g), ColorSRGBToLinear(c.b), c.a); }
+    static Color to_srgb(const Color& c)    { return Color(ColorLinearToSRGB(c.r), ColorLinearToSRGB(c.g), ColorLinearToSRGB(c.b), c.a); }
+    static uint32 pack_linear(const Color& c) {
+        uint32 out;
+        ColorConvertLinearToSRGB8Batch(&c, &out, 1);
+        return out;
+    }
+
+    Color blend(const Color& a, const Color& b, float t) const {
+        if (interpolation_color_space == GRADIENT_COLOR_SPACE_LINEAR_SRGB) {
+            const Color la = to_linear(a);
+            const Color lb = to_linear(b);
+            return to_srgb(Color(la.r + (lb.r - la.r) * t, la.g + (lb.g - la.g) * t, la.b + (lb.b - la.b) * t, la.a + (lb.a - la.a) * t));
+        }
+        return Color(a.r + (b.r - a.r) * t, a.g + (b.g - a.g) * t, a.b + (b.b - a.b) * t, a.a + (b.a - a.a) * t);
+    }
+};
+
+struct AABB2
 {
     Vector2 position;
 	Vector2 size;
 } AABB2;
 
-struct AABB3 : public Variant
+struct AABB3
 {
     Vector3 position;
 	Vector3 size;
 } AABB3;
 
-struct Transform2D : public Variant
+struct Transform2D
 {
 	Vector2 position;
 	Vector2 rotate;
@@ -1354,4 +1641,427 @@ struct Transform3D
 	Vector3 scale;
 } Transform;
 
+/*======================================================================================
+
+    Variant
+
+    24 bytes: a type tag and 16 bytes of payload. Every value type up to 16 bytes (numbers,
+    vectors, rects, colors) is stored inline, so a Variant holding math never allocates.
+    Bigger types are heap allocated once, ref counted and copied on write, so copying a
+    Variant is at most an atomic increment. Operators dispatch through a jump table indexed
+    by [operator][left type][right type] instead of virtual calls.
+*/
+
+enum VariantType
+{
+    VARIANT_NIL,
+
+    // Inline
+    VARIANT_BOOL,
+    VARIANT_INT,
+    VARIANT_FLOAT,
+    VARIANT_VECTOR2,
+    VARIANT_VECTOR2I,
+    VARIANT_VECTOR3,
+    VARIANT_VECTOR3I,
+    VARIANT_VECTOR4,
+    VARIANT_VECTOR4I,
+    VARIANT_RECT,
+    VARIANT_RECTI,
+    VARIANT_COLOR,
+    VARIANT_AABB2,
+    VARIANT_OBJECT,         // Not owned
+
+    // Heap, ref counted, copy on write
+    VARIANT_AABB3,
+    VARIANT_TRANSFORM2D,
+    VARIANT_TRANSFORM3D,
+    VARIANT_ARRAY,
+    VARIANT_DICTIONARY,
+    VARIANT_CURVE,
+    VARIANT_CURVE2D,
+    VARIANT_CURVE3D,
+
+    VARIANT_MAX
+};
+#define VARIANT_FIRST_REF_TYPE  VARIANT_AABB3
+
+enum VariantOperator
+{
+    VARIANT_OP_ADD,
+    VARIANT_OP_SUBTRACT,
+    VARIANT_OP_MULTIPLY,
+    VARIANT_OP_DIVIDE,
+    VARIANT_OP_MODULE,
+    VARIANT_OP_EQUAL,
+    VARIANT_OP_NOT_EQUAL,
+    VARIANT_OP_LESS,
+    VARIANT_OP_LESS_EQUAL,
+    VARIANT_OP_GREATER,
+    VARIANT_OP_GREATER_EQUAL,
+    VARIANT_OP_MAX
+};
+
+typedef TArray<Variant>         VariantArray;
+typedef TMap<Variant, Variant>  VariantDictionary;
+
+// C++ type -> VariantType. Integers are stored as int64 and reals as double.
+template<typename T> struct VariantTypeInfo;
+#define VARIANT_TYPE_INFO(T, TYPE) template<> struct VariantTypeInfo<T> { static const VariantType Type = TYPE; static const bool IsRef = TYPE >= VARIANT_FIRST_REF_TYPE; }
+VARIANT_TYPE_INFO(bool,                 VARIANT_BOOL);
+VARIANT_TYPE_INFO(int64,                VARIANT_INT);
+VARIANT_TYPE_INFO(double,               VARIANT_FLOAT);
+VARIANT_TYPE_INFO(Vector2,              VARIANT_VECTOR2);
+VARIANT_TYPE_INFO(Vector2i,             VARIANT_VECTOR2I);
+VARIANT_TYPE_INFO(Vector3,              VARIANT_VECTOR3);
+VARIANT_TYPE_INFO(Vector3i,             VARIANT_VECTOR3I);
+VARIANT_TYPE_INFO(Vector4,              VARIANT_VECTOR4);
+VARIANT_TYPE_INFO(Vector4i,             VARIANT_VECTOR4I);
+VARIANT_TYPE_INFO(Rect,                 VARIANT_RECT);
+VARIANT_TYPE_INFO(Recti,                VARIANT_RECTI);
+VARIANT_TYPE_INFO(Color,                VARIANT_COLOR);
+VARIANT_TYPE_INFO(AABB2,                VARIANT_AABB2);
+VARIANT_TYPE_INFO(Object*,              VARIANT_OBJECT);
+VARIANT_TYPE_INFO(AABB3,                VARIANT_AABB3);
+VARIANT_TYPE_INFO(Transform2D,          VARIANT_TRANSFORM2D);
+VARIANT_TYPE_INFO(Transform3D,          VARIANT_TRANSFORM3D);
+VARIANT_TYPE_INFO(VariantArray,         VARIANT_ARRAY);
+VARIANT_TYPE_INFO(VariantDictionary,    VARIANT_DICTIONARY);
+VARIANT_TYPE_INFO(Curve,                VARIANT_CURVE);
+VARIANT_TYPE_INFO(Curve2D,              VARIANT_CURVE2D);
+VARIANT_TYPE_INFO(Curve3D,              VARIANT_CURVE3D);
+#undef VARIANT_TYPE_INFO
+
+// Heap payload. No vtable, the owning Variant's type tag says what to delete.
+struct VariantRefBase
+{
+    std::atomic<int32> RefCount;
+    VariantRefBase() : RefCount(1) {}
+};
+
+template<typename T>
+struct VariantRef : public VariantRefBase
+{
+    T Value;
+    VariantRef(const T& v) : Value(v) {}
+};
+
+// Lets Variant be a TMap key, specialized before anything can instantiate it.
+namespace std {
+template<> struct hash<Variant> { size_t operator()(const Variant& v) const; };
+}
+
+struct Variant
+{
+    Variant()                           { _clear(); }
+    Variant(bool v)                     { _set_inline(v); }
+    Variant(int v)                      { _set_inline((int64)v); }
+    Variant(uint32 v)                   { _set_inline((int64)v); }
+    Variant(int64 v)                    { _set_inline(v); }
+    Variant(float v)                    { _set_inline((double)v); }
+    Variant(double v)                   { _set_inline(v); }
+    Variant(const Vector2& v)           { _set_inline(v); }
+    Variant(const Vector2i& v)          { _set_inline(v); }
+    Variant(const Vector3& v)           { _set_inline(v); }
+    Variant(const Vector3i& v)          { _set_inline(v); }
+    Variant(const Vector4& v)           { _set_inline(v); }
+    Variant(const Vector4i& v)          { _set_inline(v); }
+    Variant(const Rect& v)              { _set_inline(v); }
+    Variant(const Recti& v)             { _set_inline(v); }
+    Variant(const Color& v)             { _set_inline(v); }
+    Variant(const AABB2& v)             { _set_inline(v); }
+    Variant(Object* v)                  { _set_inline(v); }
+    Variant(const AABB3& v)             { _set_ref(v); }
+    Variant(const Transform2D& v)       { _set_ref(v); }
+    Variant(const Transform3D& v)       { _set_ref(v); }
+    Variant(const VariantArray& v);
+    Variant(const VariantDictionary& v);
+    Variant(const Curve& v)             { _set_ref(v); }
+    Variant(const Curve2D& v)           { _set_ref(v); }
+    Variant(const Curve3D& v)           { _set_ref(v); }
+
+    Variant(const Variant& other) : Type(other.Type), Data(other.Data) { _ref(); }
+    Variant(Variant&& other) noexcept : Type(other.Type), Data(other.Data) { other.Type = VARIANT_NIL; }
+    ~Variant() { _unref(); }
+
+    Variant& operator=(const Variant& other) {
+        if (this != &other) {
+            other._ref();
+            _unref();
+            Type = other.Type;
+            Data = other.Data;
+        }
+        return *this;
+    }
+
+    Variant& operator=(Variant&& other) noexcept {
+        if (this != &other) {
+            _unref();
+            Type = other.Type;
+            Data = other.Data;
+            other.Type = VARIANT_NIL;
+        }
+        return *this;
+    }
+
+    VariantType get_type() const        { return (VariantType)Type; }
+    bool        is_nil() const          { return Type == VARIANT_NIL; }
+    bool        is_ref_counted() const  { return Type >= VARIANT_FIRST_REF_TYPE; }
+    int32       get_ref_count() const   { return is_ref_counted() ? Data.Ref->RefCount.load(std::memory_order_relaxed) : 0; }
+
+    // Typed access, the type must match exactly (no conversion).
+    template<typename T> const T& get() const {
+        assert(Type == VariantTypeInfo<T>::Type);
+        if (VariantTypeInfo<T>::IsRef)
+            return static_cast<const VariantRef<T>*>(Data.Ref)->Value;
+        return *reinterpret_cast<const T*>(Data.Mem);
+    }
+
+    // Mutable access. Shared heap data is copied first, so other Variants never see the write.
+    template<typename T> T& get_mut() {
+        assert(Type == VariantTypeInfo<T>::Type);
+        if (VariantTypeInfo<T>::IsRef) {
+            if (Data.Ref->RefCount.load(std::memory_order_acquire) > 1) {
+                VariantRefBase* shared = Data.Ref;
+                Data.Ref = new VariantRef<T>(static_cast<VariantRef<T>*>(shared)->Value);
+                _release(Type, shared);
+            }
+            return static_cast<VariantRef<T>*>(Data.Ref)->Value;
+        }
+        return *reinterpret_cast<T*>(Data.Mem);
+    }
+
+    // Scalar conversions, 0/false for anything that isn't a number.
+    bool   to_bool() const  { return Type == VARIANT_BOOL ? Data.Bool : Type == VARIANT_INT ? Data.Int != 0 : Type == VARIANT_FLOAT ? Data.Float != 0.0 : Type != VARIANT_NIL; }
+    int64  to_int() const   { return Type == VARIANT_INT ? Data.Int : Type == VARIANT_FLOAT ? (int64)Data.Float : Type == VARIANT_BOOL ? (int64)Data.Bool : 0; }
+    double to_float() const { return Type == VARIANT_FLOAT ? Data.Float : Type == VARIANT_INT ? (double)Data.Int : Type == VARIANT_BOOL ? (double)Data.Bool : 0.0; }
+
+    // Returns false (and sets r_ret to nil) when the operator isn't defined for the two types.
+    static bool evaluate(VariantOperator op, const Variant& a, const Variant& b, Variant& r_ret);
+
+    Variant operator+(const Variant& other) const { Variant r; evaluate(VARIANT_OP_ADD, *this, other, r); return r; }
+    Variant operator-(const Variant& other) const { Variant r; evaluate(VARIANT_OP_SUBTRACT, *this, other, r); return r; }
+    Variant operator*(const Variant& other) const { Variant r; evaluate(VARIANT_OP_MULTIPLY, *this, other, r); return r; }
+    Variant operator/(const Variant& other) const { Variant r; evaluate(VARIANT_OP_DIVIDE, *this, other, r); return r; }
+    Variant operator%(const Variant& other) const { Variant r; evaluate(VARIANT_OP_MODULE, *this, other, r); return r; }
+    bool    operator<(const Variant& other) const { Variant r; evaluate(VARIANT_OP_LESS, *this, other, r); return r.to_bool(); }
+    bool    operator==(const Variant& other) const;
+    bool    operator!=(const Variant& other) const { return !(*this == other); }
+
+    uint32  hash() const;
+
+private:
+    void _clear() { Type = VARIANT_NIL; memset(&Data, 0, sizeof(Data)); }
+
+    template<typename T> void _set_inline(const T& v) {
+        static_assert(sizeof(T) <= sizeof(Data), "Type doesn't fit inline in a Variant");
+        _clear();
+        Type = VariantTypeInfo<T>::Type;
+        new(Data.Mem) T(v);
+    }
+
+    template<typename T> void _set_ref(const T& v) {
+        _clear();
+        Type = VariantTypeInfo<T>::Type;
+        Data.Ref = new VariantRef<T>(v);
+    }
+
+    void _ref() const {
+        if (Type >= VARIANT_FIRST_REF_TYPE)
+            Data.Ref->RefCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void _unref() {
+        if (Type >= VARIANT_FIRST_REF_TYPE)
+            _release(Type, Data.Ref);
+        Type = VARIANT_NIL;
+    }
+
+    static void _release(uint32 type, VariantRefBase* ref);
+
+    uint32 Type;
+    union
+    {
+        bool            Bool;
+        int64           Int;
+        double          Float;
+        VariantRefBase* Ref;
+        uint8           Mem[16];
+    } Data;
+};
+static_assert(sizeof(Variant) == 24, "Variant must stay 24 bytes");
+
+inline size_t std::hash<Variant>::operator()(const Variant& v) const { return v.hash(); }
+
+inline Variant::Variant(const VariantArray& v)      { _set_ref(v); }
+inline Variant::Variant(const VariantDictionary& v) { _set_ref(v); }
+
+inline void Variant::_release(uint32 type, VariantRefBase* ref)
+{
+    if (ref->RefCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        switch (type) {
+        case VARIANT_AABB3:         delete static_cast<VariantRef<AABB3>*>(ref); break;
+        case VARIANT_TRANSFORM2D:   delete static_cast<VariantRef<Transform2D>*>(ref); break;
+        case VARIANT_TRANSFORM3D:   delete static_cast<VariantRef<Transform3D>*>(ref); break;
+        case VARIANT_ARRAY:         delete static_cast<VariantRef<VariantArray>*>(ref); break;
+        case VARIANT_DICTIONARY:    delete static_cast<VariantRef<VariantDictionary>*>(ref); break;
+        case VARIANT_CURVE:         delete static_cast<VariantRef<Curve>*>(ref); break;
+        case VARIANT_CURVE2D:       delete static_cast<VariantRef<Curve2D>*>(ref); break;
+        case VARIANT_CURVE3D:       delete static_cast<VariantRef<Curve3D>*>(ref); break;
+        default: assert(0); break;
+        }
+    }
+}
+
+// - Operator jump table
+// Each entry evaluates one (operator, left type, right type) combination, null when undefined.
+typedef bool (*VariantOperatorEvaluator)(const Variant& a, const Variant& b, Variant& r_ret);
+
+struct VariantOpAdd         { template<typename A, typename B> static bool apply(const A& a, const B& b, Variant& r) { r = a + b; return true; } };
+struct VariantOpSubtract    { template<typename A, typename B> static bool apply(const A& a, const B& b, Variant& r) { r = a - b; return true; } };
+struct VariantOpMultiply    { template<typename A, typename B> static bool apply(const A& a, const B& b, Variant& r) { r = a * b; return true; } };
+
+// Integer division traps on a zero divisor and on MIN / -1, those evaluate to false like an undefined operator.
+// Integer vectors take the int64 scalar as an int, the check runs on the narrowed value.
+template<typename A, typename B> inline bool VariantCanDivide(const A&, const B&) { return true; }
+inline bool VariantCanDivide(const int64& a, const int64& b)        { return b != 0 && (b != -1 || a != LLONG_MIN); }
+inline bool VariantCanDivide(const int& a, const int& b)            { return b != 0 && (b != -1 || a != INT_MIN); }
+inline bool VariantCanDivide(const Vector2i& a, const Vector2i& b)  { return VariantCanDivide(a.x, b.x) && VariantCanDivide(a.y, b.y); }
+inline bool VariantCanDivide(const Vector3i& a, const Vector3i& b)  { return VariantCanDivide(a.x, b.x) && VariantCanDivide(a.y, b.y) && VariantCanDivide(a.z, b.z); }
+inline bool VariantCanDivide(const Vector4i& a, const Vector4i& b)  { return VariantCanDivide(a.x, b.x) && VariantCanDivide(a.y, b.y) && VariantCanDivide(a.z, b.z) && VariantCanDivide(a.w, b.w); }
+inline bool VariantCanDivide(const Vector2i& a, const int64& b)     { return VariantCanDivide(a, Vector2i((int)b)); }
+inline bool VariantCanDivide(const Vector3i& a, const int64& b)     { return VariantCanDivide(a, Vector3i((int)b)); }
+inline bool VariantCanDivide(const Vector4i& a, const int64& b)     { return VariantCanDivide(a, Vector4i((int)b)); }
+inline bool VariantCanDivide(const int64& a, const Vector2i& b)     { return VariantCanDivide(Vector2i((int)a), b); }
+inline bool VariantCanDivide(const int64& a, const Vector3i& b)     { return VariantCanDivide(Vector3i((int)a), b); }
+inline bool VariantCanDivide(const int64& a, const Vector4i& b)     { return VariantCanDivide(Vector4i((int)a), b); }
+
+struct VariantOpDivide  { template<typename A, typename B> static bool apply(const A& a, const B& b, Variant& r) { if (!VariantCanDivide(a, b)) return false; r = a / b; return true; } };
+struct VariantOpModule  { template<typename A, typename B> static bool apply(const A& a, const B& b, Variant& r) { if (!VariantCanDivide(a, b)) return false; r = a % b; return true; } };
+struct VariantOpEqual           { template<typename A, typename B> static bool apply(const A& a, const B& b, Variant& r) { r = a == b; return true; } };
+struct VariantOpNotEqual        { template<typename A, typename B> static bool apply(const A& a, const B& b, Variant& r) { r = a != b; return true; } };
+struct VariantOpLess            { template<typename A, typename B> static bool apply(const A& a, const B& b, Variant& r) { r = a < b; return true; } };
+struct VariantOpLessEqual       { template<typename A, typename B> static bool apply(const A& a, const B& b, Variant& r) { r = a <= b; return true; } };
+struct VariantOpGreater         { template<typename A, typename B> static bool apply(const A& a, const B& b, Variant& r) { r = a > b; return true; } };
+struct VariantOpGreaterEqual    { template<typename A, typename B> static bool apply(const A& a, const B& b, Variant& r) { r = a >= b; return true; } };
+
+template<typename Op, typename A, typename B>
+static bool VariantEvaluate(const Variant& a, const Variant& b, Variant& r_ret) { return Op::apply(a.get<A>(), b.get<B>(), r_ret); }
+
+struct VariantOperatorTable
+{
+    VariantOperatorEvaluator Funcs[VARIANT_OP_MAX][VARIANT_MAX][VARIANT_MAX];
+
+    VariantOperatorTable() {
+        memset(Funcs, 0, sizeof(Funcs));
+
+        // Numbers
+        add_arithmetic<int64, int64>();     add_equality<int64, int64>();   add_ordering<int64, int64>();
+        add_arithmetic<int64, double>();    add_equality<int64, double>();  add_ordering<int64, double>();
+        add_arithmetic<double, int64>();    add_equality<double, int64>();  add_ordering<double, int64>();
+        add_arithmetic<double, double>();   add_equality<double, double>(); add_ordering<double, double>();
+        add<VariantOpModule, int64, int64>(VARIANT_OP_MODULE);
+        add_equality<bool, bool>();
+
+        // Float vectors, component wise and scaled
+        add_vector<Vector2, double>();      add_vector<Vector2, int64>();
+        add_vector<Vector3, double>();      add_vector<Vector3, int64>();
+        add_vector<Vector4, double>();      add_vector<Vector4, int64>();
+
+        // Integer vectors
+        add_vector<Vector2i, int64>();      add<VariantOpModule, Vector2i, Vector2i>(VARIANT_OP_MODULE);    add<VariantOpModule, Vector2i, int64>(VARIANT_OP_MODULE);
+        add_vector<Vector3i, int64>();      add<VariantOpModule, Vector3i, Vector3i>(VARIANT_OP_MODULE);    add<VariantOpModule, Vector3i, int64>(VARIANT_OP_MODULE);
+        add_vector<Vector4i, int64>();      add<VariantOpModule, Vector4i, Vector4i>(VARIANT_OP_MODULE);    add<VariantOpModule, Vector4i, int64>(VARIANT_OP_MODULE);
+
+        // Colors
+        add_arithmetic<Color, Color>();     add_equality<Color, Color>();
+        add_arithmetic<Color, double>();
+
+        add_equality<Object*, Object*>();
+    }
+
+    template<typename Op, typename A, typename B> void add(VariantOperator op) { Funcs[op][VariantTypeInfo<A>::Type][VariantTypeInfo<B>::Type] = &VariantEvaluate<Op, A, B>; }
+
+    template<typename A, typename B> void add_arithmetic() {
+        add<VariantOpAdd, A, B>(VARIANT_OP_ADD);
+        add<VariantOpSubtract, A, B>(VARIANT_OP_SUBTRACT);
+        add<VariantOpMultiply, A, B>(VARIANT_OP_MULTIPLY);
+        add<VariantOpDivide, A, B>(VARIANT_OP_DIVIDE);
+    }
+    template<typename A, typename B> void add_equality() {
+        add<VariantOpEqual, A, B>(VARIANT_OP_EQUAL);
+        add<VariantOpNotEqual, A, B>(VARIANT_OP_NOT_EQUAL);
+    }
+    template<typename A, typename B> void add_ordering() {
+        add<VariantOpLess, A, B>(VARIANT_OP_LESS);
+        add<VariantOpLessEqual, A, B>(VARIANT_OP_LESS_EQUAL);
+        add<VariantOpGreater, A, B>(VARIANT_OP_GREATER);
+        add<VariantOpGreaterEqual, A, B>(VARIANT_OP_GREATER_EQUAL);
+    }
+    // Vector op vector, vector op scalar and scalar op vector.
+    template<typename V, typename S> void add_vector() {
+        add_arithmetic<V, V>();
+        add_equality<V, V>();
+        add_ordering<V, V>();
+        add_arithmetic<V, S>();
+        add<VariantOpAdd, S, V>(VARIANT_OP_ADD);
+        add<VariantOpSubtract, S, V>(VARIANT_OP_SUBTRACT);
+        add<VariantOpMultiply, S, V>(VARIANT_OP_MULTIPLY);
+        add<VariantOpDivide, S, V>(VARIANT_OP_DIVIDE);
+    }
+};
+
+inline const VariantOperatorTable& GetVariantOperatorTable() { static VariantOperatorTable table; return table; }
+
+inline bool Variant::evaluate(VariantOperator op, const Variant& a, const Variant& b, Variant& r_ret)
+{
+    VariantOperatorEvaluator func = GetVariantOperatorTable().Funcs[op][a.Type][b.Type];
+    if (!func || !func(a, b, r_ret)) {
+        r_ret = Variant();
+        return false;
+    }
+    return true;
+}
+
+inline bool Variant::operator==(const Variant& other) const
+{
+    Variant r;
+    if (evaluate(VARIANT_OP_EQUAL, *this, other, r))
+        return r.Data.Bool;
+    if (Type != other.Type)
+        return false;
+    // No operator registered: inline payloads compare bitwise (padding is always zeroed), heap payloads by identity.
+    if (Type >= VARIANT_FIRST_REF_TYPE)
+        return Data.Ref == other.Data.Ref;
+    return memcmp(Data.Mem, other.Data.Mem, sizeof(Data.Mem)) == 0;
+}
+
+// FNV-1a over the tag and payload. Heap payloads hash by identity.
+// int64 and double compare equal by value, so both hash the value as a double.
+inline uint32 Variant::hash() const
+{
+    if (Type == VARIANT_INT || Type == VARIANT_FLOAT) {
+        double value = Type == VARIANT_INT ? (double)Data.Int : Data.Float;
+        uint32 h = (2166136261u ^ VARIANT_FLOAT) * 16777619u;
+        if (value == 0.0) // -0.0 == 0.0
+            return h;
+        uint8 bytes[sizeof(double)];
+        memcpy(bytes, &value, sizeof(value));
+        for (int i = 0; i < (int)sizeof(bytes); i++)
+            h = (h ^ bytes[i]) * 16777619u;
+        return h;
+    }
+    uint32 h = 2166136261u ^ Type;
+    h *= 16777619u;
+    if (Type >= VARIANT_FIRST_REF_TYPE) {
+        uintptr_t p = (uintptr_t)Data.Ref;
+        for (int i = 0; i < (int)sizeof(p); i++, p >>= 8)
+            h = (h ^ (uint32)(p & 0xFF)) * 16777619u;
+        return h;
+    }
+    for (int i = 0; i < (int)sizeof(Data.Mem); i++)
+        h = (h ^ Data.Mem[i]) * 16777619u;
+    return h;
+}
+
 #endif VARIANTS_H
\ No newline at end of file
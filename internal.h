@@ -33,7 +33,8 @@
 ////////////////////////////////////////////////////////////////////////////
 
 #include "Moss.h"
-
+#include "Memory.h"     // Memory_Alloc, MEMORY_TAG_*
+#include "DrawList.h"
 
 #include <stdio.h>      // FILE*, sscanf
 #include <stdlib.h>     // NULL, malloc, free, qsort, atoi, atof
@@ -47,14 +48,8 @@
 // 3D
 */
 
-// GUi and  from ImGUi
-struct DrawChannel;               // Temporary storage to output draw commands out of order, used by ImDrawListSplitter and ImDrawList::ChannelsSplit()
-struct DrawCmd;                   // A single draw command within a parent ImDrawList (generally maps to 1 GPU draw call, unless it is a callback)
-struct DrawData;                  // All draw command lists required to render the frame + pos/size coordinates to use for the projection matrix.
-struct DrawList;                  // A single draw command list (generally one per window, conceptually you may see this as a dynamic "mesh" builder)
+// GUi and  from ImGUi. DrawCmd, DrawData, DrawList, DrawVert, DrawChannel and DrawListSplitter are in DrawList.h
 struct DrawListSharedData;        // Data shared among multiple draw lists (typically owned by parent ImGui context, but you may create one yourself)
-struct DrawListSplitter;          // Helper to split a draw list into different layers which can be drawn into out of order, then flattened back.
-struct DrawVert;                  // A single vertex (pos + uv + col = 20 bytes by default. Override layout with IMGUI_OVERRIDE_DRAWVERT_STRUCT_LAYOUT)
 
 /*======================================================================================
 
@@ -98,37 +93,71 @@ struct FontDummy
 
 };
 
-/**/
+/* Pixels are owned, allocated with Memory_Alloc(MEMORY_TAG_TEXTURES) */
 struct ImageDummy
 {
 	const char* path;
 	int height;
 	int width;
+	int channels;
+	uint8* pixels;
 };
 
-/**/
+/* GPU side copy, 'size' is tracked under MEMORY_TAG_TEXTURES for as long as the texture lives */
 struct TextureDummy
 {
 	const char* path;
 	int height;
 	int width;
+	uint32 id;
+	size_t size;
 };
 
+static inline bool ImageDummy_Alloc(ImageDummy* image, int width, int height, int channels) {
+    image->width = width;
+    image->height = height;
+    image->channels = channels;
+    image->pixels = (uint8*)Memory_Alloc((size_t)width * height * channels, MEMORY_TAG_TEXTURES);
+    return image->pixels != NULL;
+}
+
+static inline void ImageDummy_Free(ImageDummy* image) {
+    Memory_Free(image->pixels);
+    image->pixels = NULL;
+}
+
+// Video memory isn't ours to malloc, so it is accounted without a header.
+static inline void TextureDummy_TrackUpload(TextureDummy* texture, size_t size) {
+    texture->size = size;
+    GetMemoryTracker().on_alloc(MEMORY_TAG_TEXTURES, size);
+}
+
+static inline void TextureDummy_TrackRelease(TextureDummy* texture) {
+    if (texture->size)
+        GetMemoryTracker().on_free(MEMORY_TAG_TEXTURES, texture->size);
+    texture->size = 0;
+}
+
 /**/
 struct FastNoiseDummy
 {
 
 };
 
-/**/
+/* 'uv_rect' is (0, 0, 1, 1) for a texture of its own, the sub-rect when it was packed into a TextureAtlas page ('id' is the page's, see TextureAtlas::apply()) */
 struct Texture2DDummy
 {
-    uint8 id;
+    uint32 id;
 	int height;
 	int width;
     const char* path;
+    Vector4 uv_rect = Vector4(0.0f, 0.0f, 1.0f, 1.0f);
 };
 
+static inline Vector2 Texture2DDummy_RemapUV(const Texture2DDummy* texture, const Vector2& uv) {
+    return Vector2(texture->uv_rect.x + (texture->uv_rect.z - texture->uv_rect.x) * uv.x, texture->uv_rect.y + (texture->uv_rect.w - texture->uv_rect.y) * uv.y);
+}
+
 /**/
 struct LevelDummy
 {